@@ -0,0 +1,27 @@
+#ifndef MJOLNIR_BENCH_H
+#define MJOLNIR_BENCH_H
+
+#include <algorithm>// for min
+#include <chrono>   // for steady_clock, duration
+#include <cstddef>  // for size_t
+
+namespace mjolnir::bench {
+    // The fastest of `runs` runs of `run`, in seconds.
+    template<typename Run>
+    double best_of(std::size_t runs, Run &&run) {
+        double best{};
+        for (std::size_t i{0}; i < runs; ++i) {
+            auto const start{std::chrono::steady_clock::now()};
+            run();
+            std::chrono::duration<double> const elapsed{
+                    std::chrono::steady_clock::now() - start
+            };
+
+            best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+        }
+
+        return best;
+    }
+}// namespace mjolnir::bench
+
+#endif//MJOLNIR_BENCH_H
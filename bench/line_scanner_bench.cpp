@@ -0,0 +1,61 @@
+#include <cstddef>    // for size_t
+#include <cstdio>     // for printf
+#include <random>     // for mt19937, uniform_int_distribution
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <utility>    // for pair
+#include <vector>     // for vector
+
+#include "bench.h"           // for best_of
+#include "line_scanner.h"    // for scan_lines, LineKernel, is_supported
+#include "mjolnir/source.hpp"// for Line
+
+namespace {
+    using namespace mjolnir;
+    using internal::LineKernel;
+
+    // About `size` bytes of lines between 0 and 120 bytes long.
+    std::string make_buffer(std::size_t size) {
+        std::mt19937                               rng{42};
+        std::uniform_int_distribution<std::size_t> line_length{0, 120};
+
+        std::string buffer;
+        buffer.reserve(size + 121);
+        while (buffer.size() < size) {
+            buffer.append(line_length(rng), 'x');
+            buffer.push_back('\n');
+        }
+
+        return buffer;
+    }
+}// namespace
+
+int main() {
+    constexpr std::size_t size{64 << 20};
+
+    auto const buffer{make_buffer(size)};
+
+    std::pair<LineKernel, char const *> const kernels[]{
+            {LineKernel::Memchr, "memchr"},
+            {LineKernel::Sse2, "sse2"},
+            {LineKernel::Avx2, "avx2"}
+    };
+    for (auto const [kernel, name] : kernels) {
+        if (!internal::is_supported(kernel)) {
+            std::printf("%-8s unsupported\n", name);
+            continue;
+        }
+
+        std::vector<Line> lines;
+        auto const        seconds{bench::best_of(5, [&] {
+            lines.clear();
+            internal::scan_lines(kernel, buffer, 0, 0, buffer.size(), lines);
+        })};
+
+        std::printf(
+                "%-8s %8.1f MiB/s  %zu lines\n", name,
+                static_cast<double>(buffer.size()) / seconds / (1 << 20),
+                lines.size()
+        );
+    }
+}
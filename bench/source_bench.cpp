@@ -0,0 +1,65 @@
+#include <cstddef>    // for size_t
+#include <cstdio>     // for printf
+#include <random>     // for mt19937, uniform_int_distribution
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <utility>    // for pair
+#include <vector>     // for vector
+
+#include "bench.h"           // for best_of
+#include "mjolnir/source.hpp"// for Source, LineTable
+
+namespace {
+    using namespace mjolnir;
+
+    constexpr std::size_t line_count{1'000'000};
+    constexpr std::size_t lookup_count{1'000'000};
+
+    // line_count lines between 0 and 120 bytes long.
+    std::string make_buffer() {
+        std::mt19937                               rng{42};
+        std::uniform_int_distribution<std::size_t> line_length{0, 120};
+
+        std::string buffer;
+        for (std::size_t i{0}; i < line_count; ++i) {
+            buffer.append(line_length(rng), 'x');
+            buffer.push_back('\n');
+        }
+
+        return buffer;
+    }
+}// namespace
+
+int main() {
+    auto const buffer{make_buffer()};
+
+    std::mt19937                               rng{7};
+    std::uniform_int_distribution<std::size_t> pick{0, buffer.size() - 1};
+    std::vector<std::size_t>                   offsets(lookup_count);
+    for (auto &offset : offsets) offset = pick(rng);
+
+    std::pair<LineTable, char const *> const tables[]{
+            {LineTable::Full, "full"},
+            {LineTable::Compact, "compact"}
+    };
+    for (auto const [table, table_name] : tables) {
+        for (bool const lookup_table : {false, true}) {
+            Source source{"bench.c", buffer, Indexing::Eager, table};
+            if (lookup_table)
+                source.build_lookup_table();
+
+            std::size_t checksum{0};
+            auto const  seconds{bench::best_of(5, [&] {
+                for (auto const offset : offsets) {
+                    checksum += source.get_line_info(offset)->line_number_;
+                }
+            })};
+
+            std::printf(
+                    "%-8s %-14s %6.1f ns/lookup  (%zu)\n", table_name,
+                    lookup_table ? "lookup table" : "binary search",
+                    seconds * 1e9 / lookup_count, checksum
+            );
+        }
+    }
+}
@@ -0,0 +1,196 @@
+#ifndef MJOLNIR_BOUNDED_QUEUE_H
+#define MJOLNIR_BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace mjolnir {
+    // What submitting to a full queue does.
+    enum class Backpressure {
+        Block,       // wait for the consumer to make room
+        DropOldest,  // make room by dropping the oldest queued item
+        CountAndDrop,// drop the new item, only counting it
+    };
+
+    struct QueueStats final {
+        std::size_t high_water_mark;
+        std::size_t dropped;
+    };
+
+    namespace internal {
+        // A bounded lock-free queue after Dmitry Vyukov's: every cell carries
+        // a sequence number that tells producers and consumers whose turn it
+        // is to use it. Any number of threads may push and pop at once.
+        template<typename T>
+        class BoundedQueue final {
+            static constexpr std::size_t cache_line{64};
+
+            struct Cell final {
+                std::atomic<std::size_t> sequence_;
+                std::optional<T>         value_;
+            };
+
+            std::unique_ptr<Cell[]> cells_;
+            std::size_t             mask_;
+
+            // apart, so producers and consumers don't fight over a line
+            alignas(cache_line) std::atomic<std::size_t> enqueue_pos_{0};
+            alignas(cache_line) std::atomic<std::size_t> dequeue_pos_{0};
+            alignas(cache_line) std::atomic<std::size_t> high_water_mark_{0};
+            std::atomic<std::size_t> dropped_{0};
+
+            void record_size(std::size_t size) noexcept {
+                auto seen{high_water_mark_.load(std::memory_order_relaxed)};
+                while (seen < size &&
+                       !high_water_mark_.compare_exchange_weak(
+                               seen, size, std::memory_order_relaxed
+                       )) {}
+            }
+
+        public:
+            // The capacity is rounded up to a power of two, and to at least 2.
+            explicit BoundedQueue(std::size_t capacity)
+                : cells_{std::make_unique<Cell[]>(
+                          std::bit_ceil(std::max(capacity, std::size_t{2}))
+                  )}
+                , mask_{std::bit_ceil(std::max(capacity, std::size_t{2})) - 1} {
+                for (std::size_t i{0}; i <= mask_; ++i) {
+                    cells_[i].sequence_.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            // Only moves from `value` if there was room for it.
+            [[nodiscard]]
+            bool try_push(T &value) {
+                Cell *cell;
+                auto  pos{enqueue_pos_.load(std::memory_order_relaxed)};
+
+                while (true) {
+                    cell = &cells_[pos & mask_];
+                    auto const sequence{
+                            cell->sequence_.load(std::memory_order_acquire)
+                    };
+                    auto const lag{
+                            static_cast<std::intptr_t>(sequence) -
+                            static_cast<std::intptr_t>(pos)
+                    };
+
+                    if (lag == 0) {
+                        if (enqueue_pos_.compare_exchange_weak(
+                                    pos, pos + 1, std::memory_order_relaxed
+                            ))
+                            break;
+                    } else if (lag < 0) {
+                        return false;// a whole lap ahead of the consumers
+                    } else {
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+
+                cell->value_.emplace(std::move(value));
+                cell->sequence_.store(pos + 1, std::memory_order_release);
+
+                // consumers may have raced past this cell already
+                auto const popped{dequeue_pos_.load(std::memory_order_relaxed)};
+                if (popped <= pos)
+                    record_size(std::min(pos + 1 - popped, mask_ + 1));
+                return true;
+            }
+
+            [[nodiscard]]
+            std::optional<T> try_pop() {
+                Cell *cell;
+                auto  pos{dequeue_pos_.load(std::memory_order_relaxed)};
+
+                while (true) {
+                    cell = &cells_[pos & mask_];
+                    auto const sequence{
+                            cell->sequence_.load(std::memory_order_acquire)
+                    };
+                    auto const lag{
+                            static_cast<std::intptr_t>(sequence) -
+                            static_cast<std::intptr_t>(pos + 1)
+                    };
+
+                    if (lag == 0) {
+                        if (dequeue_pos_.compare_exchange_weak(
+                                    pos, pos + 1, std::memory_order_relaxed
+                            ))
+                            break;
+                    } else if (lag < 0) {
+                        return std::nullopt;// nothing pushed here yet
+                    } else {
+                        pos = dequeue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+
+                std::optional<T> value{std::move(cell->value_)};
+                cell->value_.reset();
+                cell->sequence_.store(
+                        pos + mask_ + 1, std::memory_order_release
+                );
+
+                dequeue_pos_.notify_all();
+                return value;
+            }
+
+            // Returns whether `value` made it into the queue. Whatever is
+            // dropped instead, `value` itself or the oldest item to make room
+            // for it, is handed to `on_dropped`.
+            template<std::invocable<T &&> OnDropped = decltype([](T &&) {})>
+            bool push(
+                    T value, Backpressure backpressure,
+                    OnDropped &&on_dropped = {}
+            ) {
+                while (true) {
+                    auto const popped{
+                            dequeue_pos_.load(std::memory_order_acquire)
+                    };
+                    if (try_push(value))
+                        return true;
+
+                    switch (backpressure) {
+                        case Backpressure::Block:
+                            dequeue_pos_.wait(
+                                    popped, std::memory_order_acquire
+                            );
+                            break;
+                        case Backpressure::DropOldest:
+                            if (auto oldest{try_pop()}) {
+                                dropped_.fetch_add(
+                                        1, std::memory_order_relaxed
+                                );
+                                on_dropped(std::move(*oldest));
+                            }
+                            break;
+                        case Backpressure::CountAndDrop:
+                            dropped_.fetch_add(
+                                    1, std::memory_order_relaxed
+                            );
+                            on_dropped(std::move(value));
+                            return false;
+                    }
+                }
+            }
+
+            [[nodiscard]]
+            QueueStats get_stats() const noexcept {
+                auto const high_water_mark{
+                        high_water_mark_.load(std::memory_order_relaxed)
+                };
+
+                return {.high_water_mark = high_water_mark,
+                        .dropped = dropped_.load(std::memory_order_relaxed)};
+            }
+        };
+    }// namespace internal
+}// namespace mjolnir
+
+#endif//MJOLNIR_BOUNDED_QUEUE_H
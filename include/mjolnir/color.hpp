@@ -1,15 +1,185 @@
 #ifndef MJOLNIR_COLOR_H
 #define MJOLNIR_COLOR_H
 
-#include <cstdint>      // for uint8_t, uint32_t
-#include <string>       // for string
-#include <string_view>  // for string_view
+#include <algorithm>       // for max, min
+#include <array>           // for array
+#include <cstddef>         // for size_t
+#include <cstdint>         // for uint8_t, uint32_t
+#include <initializer_list>// for initializer_list
+#include <string>          // for string
+#include <string_view>     // for string_view
 
 namespace mjolnir {
+    // How many colors whatever a report is rendered for can show. Colors are
+    // downsampled to the closest one available, and None leaves out escape
+    // sequences altogether.
+    enum class ColorMode { TrueColor, Palette256, Palette16, None };
+
+    namespace internal {
+        // An SGR escape sequence, formatted once up front (at compile time
+        // for constexpr Colors and the palette tables below).
+        class EscapeSequence final {
+            // "\033[38;2;255;255;255m"
+            static constexpr std::size_t max_size{19};
+
+            std::array<char, max_size> chars_{};
+            std::uint8_t               size_{0};
+
+            constexpr void append(char c) noexcept {
+                chars_[size_++] = c;
+            }
+
+            constexpr void append(std::uint8_t value) noexcept {
+                if (value >= 100)
+                    append(static_cast<char>('0' + value / 100));
+
+                if (value >= 10)
+                    append(static_cast<char>('0' + value / 10 % 10));
+
+                append(static_cast<char>('0' + value % 10));
+            }
+
+        public:
+            constexpr EscapeSequence() noexcept = default;
+
+            constexpr EscapeSequence(
+                    std::initializer_list<std::uint8_t> parameters
+            ) noexcept {
+                append('\033');
+                append('[');
+                for (bool first{true}; auto const parameter : parameters) {
+                    if (!first)
+                        append(';');
+
+                    append(parameter);
+                    first = false;
+                }
+                append('m');
+            }
+
+            [[nodiscard]]
+            constexpr std::string_view view() const noexcept {
+                return {chars_.data(), size_};
+            }
+        };
+
+        struct Rgb final {
+            int r_;
+            int g_;
+            int b_;
+
+            [[nodiscard]]
+            constexpr bool operator==(Rgb const &other) const = default;
+        };
+
+        [[nodiscard]]
+        constexpr int squared_distance(Rgb const &a, Rgb const &b) noexcept {
+            return (a.r_ - b.r_) * (a.r_ - b.r_) +
+                   (a.g_ - b.g_) * (a.g_ - b.g_) +
+                   (a.b_ - b.b_) * (a.b_ - b.b_);
+        }
+
+        // Going by distance alone would turn pastels like light_red into
+        // gray, so the hue comes from whichever channels stand out and the
+        // brightness from the strongest one.
+        [[nodiscard]]
+        constexpr std::uint8_t to_palette16(Rgb const &color) noexcept {
+            auto const high{std::max({color.r_, color.g_, color.b_})};
+            auto const low{std::min({color.r_, color.g_, color.b_})};
+
+            if (high - low < 32) {// close enough to a shade of gray
+                if (high < 64)
+                    return 0;
+
+                if (high < 160)
+                    return 8;
+
+                return high < 224 ? 7 : 15;
+            }
+
+            auto const stands_out{[&](int channel) {
+                return 2 * channel > high + low;
+            }};
+            auto const index{
+                    (stands_out(color.r_) ? 1 : 0) |
+                    (stands_out(color.g_) ? 2 : 0) |
+                    (stands_out(color.b_) ? 4 : 0)
+            };
+
+            return static_cast<std::uint8_t>(high >= 192 ? index + 8 : index);
+        }
+
+        // Picks whichever is closer of the nearest entry in the 6x6x6 color
+        // cube and the nearest shade on the grayscale ramp.
+        [[nodiscard]]
+        constexpr std::uint8_t to_palette256(Rgb const &color) noexcept {
+            constexpr std::array<int, 6> levels{0x00, 0x5F, 0x87,
+                                                0xAF, 0xD7, 0xFF};
+            constexpr auto               to_level{[](int value) {
+                return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40;
+            }};
+
+            auto const r{to_level(color.r_)};
+            auto const g{to_level(color.g_)};
+            auto const b{to_level(color.b_)};
+            Rgb const  cube{levels[r], levels[g], levels[b]};
+            auto const cube_index{16 + 36 * r + 6 * g + b};
+
+            if (cube == color)
+                return static_cast<std::uint8_t>(cube_index);
+
+            auto const average{(color.r_ + color.g_ + color.b_) / 3};
+            auto const gray_index{average > 238 ? 23 : (average - 3) / 10};
+            auto const gray_level{8 + 10 * gray_index};
+            Rgb const  gray{gray_level, gray_level, gray_level};
+
+            if (squared_distance(color, gray) < squared_distance(color, cube))
+                return static_cast<std::uint8_t>(232 + gray_index);
+
+            return static_cast<std::uint8_t>(cube_index);
+        }
+
+        // The escape sequences for every palette entry, built once.
+        struct PaletteEscapes final {
+            std::array<EscapeSequence, 16>  fg16_;
+            std::array<EscapeSequence, 16>  bg16_;
+            std::array<EscapeSequence, 256> fg256_;
+            std::array<EscapeSequence, 256> bg256_;
+        };
+
+        inline constexpr PaletteEscapes palette_escapes{[] {
+            PaletteEscapes escapes{};
+
+            for (std::size_t i{0}; i < escapes.fg16_.size(); ++i) {
+                // the bright half lives at 90-97 and 100-107
+                auto const offset{i < 8 ? i : i - 8 + 60};
+
+                escapes.fg16_[i] = {static_cast<std::uint8_t>(30 + offset)};
+                escapes.bg16_[i] = {static_cast<std::uint8_t>(40 + offset)};
+            }
+
+            for (std::size_t i{0}; i < escapes.fg256_.size(); ++i) {
+                auto const index{static_cast<std::uint8_t>(i)};
+
+                escapes.fg256_[i] = {38, 5, index};
+                escapes.bg256_[i] = {48, 5, index};
+            }
+
+            return escapes;
+        }()};
+    }// namespace internal
+
     class Color final {
-        std::uint8_t r_{};
-        std::uint8_t g_{};
-        std::uint8_t b_{};
+        std::uint8_t             r_{};
+        std::uint8_t             g_{};
+        std::uint8_t             b_{};
+        std::uint8_t             palette256_{
+                internal::to_palette256({r_, g_, b_})
+        };
+        std::uint8_t             palette16_{internal::to_palette16({r_, g_, b_})
+        };
+        internal::EscapeSequence fg_start_{38, 2, r_, g_, b_};
+        internal::EscapeSequence bg_start_{48, 2, r_, g_, b_};
 
     public:
         constexpr Color() = default;
@@ -32,9 +202,39 @@ namespace mjolnir {
         [[nodiscard]]
         std::string bg(std::string_view message) const;
 
-        std::string fg_start() const;
+        [[nodiscard]]
+        constexpr std::string_view
+        fg_start(ColorMode mode = ColorMode::TrueColor) const noexcept {
+            switch (mode) {
+                case ColorMode::TrueColor:
+                    return fg_start_.view();
+                case ColorMode::Palette256:
+                    return internal::palette_escapes.fg256_[palette256_].view();
+                case ColorMode::Palette16:
+                    return internal::palette_escapes.fg16_[palette16_].view();
+                case ColorMode::None:
+                    break;
+            }
 
-        std::string bg_start() const;
+            return {};
+        }
+
+        [[nodiscard]]
+        constexpr std::string_view
+        bg_start(ColorMode mode = ColorMode::TrueColor) const noexcept {
+            switch (mode) {
+                case ColorMode::TrueColor:
+                    return bg_start_.view();
+                case ColorMode::Palette256:
+                    return internal::palette_escapes.bg256_[palette256_].view();
+                case ColorMode::Palette16:
+                    return internal::palette_escapes.bg16_[palette16_].view();
+                case ColorMode::None:
+                    break;
+            }
+
+            return {};
+        }
 
         static constexpr std::string_view end{"\033[0m"};
 
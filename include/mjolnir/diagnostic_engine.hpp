@@ -0,0 +1,218 @@
+#ifndef MJOLNIR_DIAGNOSTIC_ENGINE_H
+#define MJOLNIR_DIAGNOSTIC_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "report.hpp"
+#include "sink.hpp"
+
+namespace mjolnir {
+    // Which reports the engine lets through. Limits count reports as they are
+    // submitted; whatever is over them is dropped before it is ever queued.
+    struct DiagnosticPolicy final {
+        // Errors (promoted warnings included) past this many are dropped.
+        std::optional<std::size_t>   max_errors{};
+        // Reports past this many with the same code are dropped.
+        std::optional<std::size_t>   max_per_code{};
+        bool                         warnings_as_errors{false};
+        std::vector<BasicReportKind> suppressed_kinds{};
+        std::vector<std::string>     suppressed_codes{};
+        // Drops reports with the same kind, code, message and labels in the
+        // same source as one submitted before, however long ago, before
+        // they count toward the limits.
+        bool                         deduplicate{false};
+        // Notes on the report that was kept how many like it were dropped
+        // by the time it is written out.
+        bool                         note_duplicates{false};
+    };
+
+    struct EngineConfig final {
+        std::size_t      workers{std::thread::hardware_concurrency()};
+        // Reports submitted but not yet picked up by the engine's collector
+        // thread; what happens past that is up to `backpressure`. Once the
+        // collector holds this many itself, it leaves the rest queued until
+        // the next flush, so at most twice this many reports are pending.
+        // With Block, submit then waits for another thread to flush.
+        std::size_t      queue_capacity{1024};
+        Backpressure     backpressure{Backpressure::Block};
+        DiagnosticPolicy policy{};
+        // Has the collector write out the queue_capacity reports it holds on
+        // its own instead, as if flushed, so Block never waits on a flush.
+        // Output is then only ordered within each batch written out, and
+        // which reports make up a batch depends on timing.
+        bool             write_full_batches{false};
+    };
+
+    // Collects reports from any number of threads and renders them on a pool
+    // of worker threads. Whatever order they were submitted or rendered in,
+    // the reports of a batch are written out ordered by source name, then
+    // start position (and by their rendered text, should two reports share
+    // both). A batch is whatever a flush finds, or, with write_full_batches,
+    // a full queue_capacity of reports the collector writes out on its own.
+    //
+    // Submitting takes no lock unless the policy has limits or deduplicates,
+    // which are counted under one: reports go into a bounded lock-free
+    // queue, which a collector thread drains, so producers never wait on the
+    // output, unless Block has them wait for a flush to make room. The
+    // sources the reports refer to must outlive the engine, or at least the
+    // flush that writes those reports out.
+    class DiagnosticEngine final {
+        struct Rendered final {
+            Report             report_;
+            std::string        text_{};
+            std::exception_ptr error_{};
+        };
+
+        Sink            *sink_;
+        Backpressure     backpressure_;
+        DiagnosticPolicy policy_;
+
+        // How many errors and how many reports per code have been let
+        // through; errors_ is also read without the lock, by would_emit.
+        std::atomic<std::size_t>                        errors_{0};
+        mutable std::mutex                              counts_mutex_;
+        std::map<std::string, std::size_t, std::less<>> code_counts_;
+        // Should the policy deduplicate, the first report of every identity
+        // submitted, by identity hash, to tell apart reports whose hashes
+        // merely collide, and how often one like it has been submitted.
+        struct Occurrence final {
+            Report      report_;
+            std::size_t count_;
+        };
+
+        std::unordered_multimap<std::size_t, Occurrence> occurrences_;
+
+        internal::BoundedQueue<Report> queue_;
+        // Bumped after every push, for the collector to wait on.
+        std::atomic<std::size_t>       pushes_{0};
+
+        // What has been taken off the queue, waiting for the next flush.
+        // Once it is full, reports pile up in the queue instead, and
+        // backpressure applies. Kept reserved, so the collector never
+        // allocates.
+        std::mutex          collected_mutex_;
+        std::vector<Report> collected_;
+        std::size_t         collected_capacity_;
+        bool                write_full_batches_;
+
+        // Only one flush runs at a time; it hands its batch to the pool. The
+        // first error in a batch the collector wrote out waits here for the
+        // next flush to rethrow it.
+        std::mutex         flush_mutex_;
+        std::exception_ptr deferred_error_{};
+
+        std::mutex                  pool_mutex_;
+        std::condition_variable_any work_ready_;
+        std::condition_variable     work_done_;
+        std::span<Rendered>         batch_;
+        std::atomic<std::size_t>    next_{0};
+        std::size_t                 generation_{0};
+        std::size_t                 busy_{0};
+        // last, so the threads are stopped before anything they use goes
+        std::vector<std::jthread>   workers_;
+        std::jthread                collector_;
+
+        void render_batch();
+
+        void work(std::stop_token const &stop);
+
+        void collect(std::stop_token const &stop);
+
+        // Moves reports off the queue until `limit` are collected, returning
+        // whether that many are.
+        bool drain_queue(std::size_t limit);
+
+        // Renders and writes out everything collected so far, returning the
+        // first error instead of throwing it. Called with flush_mutex_ held.
+        [[nodiscard]]
+        std::exception_ptr write_out();
+
+        void note_duplicates(std::vector<Report> &reports) const;
+
+        // What a report of this kind is submitted as.
+        [[nodiscard]]
+        ReportKind promote(ReportKind const &kind) const noexcept;
+
+        [[nodiscard]]
+        bool counts_as_error(ReportKind const &kind) const noexcept;
+
+        // Whether the policy has anything to count submitted reports for.
+        [[nodiscard]]
+        bool keeps_counts() const noexcept;
+
+        // Checks a report against the limits and what was submitted before,
+        // taking its share of the limits if it is let through.
+        [[nodiscard]]
+        bool take_budget(Report const &report);
+
+        // Gives back what a report that was let through, but then dropped by
+        // the queue, took from the limits, and forgets it was ever seen.
+        void release_budget(Report const &report);
+
+        [[nodiscard]]
+        bool is_suppressed(
+                ReportKind const &kind, std::optional<std::string_view> code
+        ) const noexcept;
+
+    public:
+        explicit DiagnosticEngine(Sink &sink, EngineConfig const &config = {});
+
+        DiagnosticEngine(DiagnosticEngine const &) = delete;
+
+        DiagnosticEngine &operator=(DiagnosticEngine const &) = delete;
+
+        // Writes out whatever is still pending, swallowing errors.
+        ~DiagnosticEngine();
+
+        // Whether a report of this kind and code would currently make it
+        // past the policy. Cheap enough to call before building the report;
+        // once it returns false for a limit, it keeps doing so.
+        [[nodiscard]]
+        bool would_emit(
+                ReportKind const               &kind,
+                std::optional<std::string_view> code = std::nullopt
+        ) const;
+
+        // A report with the given code, or nothing if would_emit says it
+        // would be dropped anyway.
+        [[nodiscard]]
+        std::optional<Report> make_report(
+                ReportKind kind, Source const &source, std::size_t start_pos,
+                std::optional<std::string_view> code = std::nullopt,
+                Report::allocator_type          allocator = {}
+        ) const;
+
+        // Safe to call from any thread. Returns whether the report was
+        // queued, rather than dropped by the policy or because the queue was
+        // full. Warnings are turned into errors here, if the policy says so,
+        // before they are checked against it. Reports the queue drops don't
+        // count toward the limits.
+        bool submit(Report report);
+
+        [[nodiscard]]
+        QueueStats get_queue_stats() const noexcept;
+
+        // Renders everything submitted so far and writes it to the sink in
+        // order. If rendering a report throws, the first such exception is
+        // rethrown once the others have been written; so is one from a batch
+        // the collector wrote out on its own since the last flush.
+        void flush();
+    };
+}// namespace mjolnir
+
+#endif//MJOLNIR_DIAGNOSTIC_ENGINE_H
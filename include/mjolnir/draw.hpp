@@ -1,32 +1,37 @@
 #ifndef MJOLNIR_DRAW_H
 #define MJOLNIR_DRAW_H
 
-#include <string>
+#include <string_view>
 
 namespace mjolnir {
+    // A set of glyphs to draw reports with. Reports refer to the set they
+    // are configured with rather than copying it, so a custom set has to
+    // outlive them.
     struct Characters final {
-        std::string horizontal_bar_;
-        std::string vertical_bar_;
-        std::string vertical_interruption_;
-        std::string crossing_;
-        std::string arrow_up_;
-        std::string arrow_right_;
-        std::string line_top_left_;
-        std::string line_top_right_;
-        std::string line_top_middle_;
-        std::string line_bottom_left_;
-        std::string line_bottom_right_;
-        std::string line_bottom_middle_;
-        std::string branch_left_;
-        std::string branch_right_;
-        std::string highlight_center_;
-        std::string highlight_;
-        std::string box_left_;
-        std::string box_right_;
+        std::string_view horizontal_bar_;
+        std::string_view vertical_bar_;
+        std::string_view vertical_interruption_;
+        std::string_view crossing_;
+        std::string_view arrow_up_;
+        std::string_view arrow_right_;
+        std::string_view line_top_left_;
+        std::string_view line_top_right_;
+        std::string_view line_top_middle_;
+        std::string_view line_bottom_left_;
+        std::string_view line_bottom_right_;
+        std::string_view line_bottom_middle_;
+        std::string_view branch_left_;
+        std::string_view branch_right_;
+        std::string_view highlight_center_;
+        std::string_view highlight_;
+        std::string_view box_left_;
+        std::string_view box_right_;
+        // stands in for the part of a line too wide to be shown
+        std::string_view ellipsis_;
     };
 
     namespace characters {
-        Characters const unicode{
+        inline constexpr Characters unicode{
                 .horizontal_bar_        = "─",
                 .vertical_bar_          = "│",
                 .vertical_interruption_ = "·",
@@ -45,9 +50,10 @@ namespace mjolnir {
                 .highlight_             = "─",
                 .box_left_              = "[",
                 .box_right_             = "]",
+                .ellipsis_              = "…",
         };
 
-        Characters const ascii{
+        inline constexpr Characters ascii{
                 .horizontal_bar_        = "-",
                 .vertical_bar_          = "|",
                 .vertical_interruption_ = ":",
@@ -66,6 +72,7 @@ namespace mjolnir {
                 .highlight_             = "^",
                 .box_left_              = "[",
                 .box_right_             = "]",
+                .ellipsis_              = "~",
         };
     }// namespace characters
 }// namespace mjolnir
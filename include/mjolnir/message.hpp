@@ -0,0 +1,145 @@
+#ifndef MJOLNIR_MESSAGE_H
+#define MJOLNIR_MESSAGE_H
+
+#include <format>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "sink.hpp"
+
+namespace mjolnir {
+    // Text attached to a report or label. It is either given as is, or as a
+    // format string and its arguments that are only formatted once the
+    // message is written out, so reports that never get printed don't pay
+    // for formatting at all.
+    class Message final {
+    public:
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    private:
+        // Formats the message the first time its text is needed, keeping
+        // the text for every copy of the message to share.
+        class Formatter {
+            mutable std::once_flag   formatted_;
+            mutable std::pmr::string text_;
+
+            virtual void format(std::pmr::string &text) const = 0;
+
+        public:
+            explicit Formatter(allocator_type allocator)
+                : text_{allocator} {
+            }
+
+            virtual ~Formatter() = default;
+
+            [[nodiscard]]
+            std::string_view get_text() const;
+        };
+
+        template<typename... Args>
+        class BoundFormatter final : public Formatter {
+            std::string_view    format_;
+            std::tuple<Args...> args_;
+
+            void format(std::pmr::string &text) const override {
+                std::apply(
+                        [&](auto const &...args) {
+                            format_into(
+                                    text, format_,
+                                    std::make_format_args(args...)
+                            );
+                        },
+                        args_
+                );
+            }
+
+        public:
+            template<typename... Forwarded>
+            explicit BoundFormatter(
+                    allocator_type allocator, std::string_view format,
+                    Forwarded &&...args
+            )
+                : Formatter{allocator}
+                , format_{format}
+                , args_{std::forward<Forwarded>(args)...} {
+            }
+        };
+
+        std::pmr::string text_;
+        // Never changes once bound, so copies of a message share it.
+        std::shared_ptr<Formatter const> formatter_;
+
+        static void format_into(
+                std::pmr::string &text, std::string_view format,
+                std::format_args args
+        );
+
+        // Makes this message say what `other` does, in its own resource.
+        void assign(Message const &other);
+
+    public:
+        explicit Message(std::string_view text, allocator_type allocator = {});
+
+        // The arguments are copied (decayed, as with std::bind), so anything
+        // they point to has to outlive the message.
+        template<typename... Args>
+        Message(allocator_type allocator, std::format_string<Args...> format,
+                Args &&...args)
+            : text_{allocator}
+            , formatter_{std::allocate_shared<
+                      BoundFormatter<std::decay_t<Args>...>>(
+                      allocator, allocator, format.get(),
+                      std::forward<Args>(args)...
+              )} {
+        }
+
+        // A copy uses the default memory resource, as a copied std::pmr
+        // container would.
+        Message(Message const &other);
+
+        Message(Message &&other) noexcept = default;
+
+        // A message in another memory resource than `other` can't share its
+        // formatter, which lives in the resource `other` was bound in, so it
+        // gets the formatted text instead.
+        Message(Message const &other, allocator_type allocator);
+
+        Message(Message &&other, allocator_type allocator);
+
+        Message &operator=(Message const &other);
+
+        Message &operator=(Message &&other);
+
+        [[nodiscard]]
+        allocator_type get_allocator() const noexcept;
+
+        void write(Sink &sink) const;
+
+        // The text as it is written. A formatted message is formatted the
+        // first time it is asked for its text, and never again after.
+        [[nodiscard]]
+        std::string_view get_text() const;
+
+        [[nodiscard]]
+        std::string to_string() const;
+
+        // Compares the text, so a formatted message equals one given as is
+        // if they come out the same.
+        [[nodiscard]]
+        bool operator==(Message const &other) const;
+    };
+}// namespace mjolnir
+
+template<>
+struct std::hash<mjolnir::Message> {
+    std::size_t operator()(mjolnir::Message const &message) const;
+};
+
+#endif//MJOLNIR_MESSAGE_H
@@ -1,14 +1,22 @@
 #ifndef MJOLNIR_REPORT_H
 #define MJOLNIR_REPORT_H
 
+#include <concepts>
+#include <format>
+#include <functional>
+#include <memory_resource>
 #include <optional>
-#include <set>
+#include <span>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "color.hpp"
 #include "draw.hpp"
+#include "message.hpp"
+#include "sink.hpp"
+#include "snippet_cache.hpp"
 #include "source.hpp"
 #include "span.hpp"
 
@@ -22,51 +30,168 @@ namespace mjolnir {
 
     using ReportKind = std::variant<BasicReportKind, CustomReportKind>;
 
+    namespace internal {
+#ifdef MJOLNIR_DISABLE_WARNING
+        inline constexpr bool warning_enabled{false};
+#else
+        inline constexpr bool warning_enabled{true};
+#endif
+
+#ifdef MJOLNIR_DISABLE_ADVICE
+        inline constexpr bool advice_enabled{false};
+#else
+        inline constexpr bool advice_enabled{true};
+#endif
+    }// namespace internal
+
     namespace report_kind {
         [[nodiscard]]
         Color to_color(ReportKind const &kind);
 
         [[nodiscard]]
         std::string_view to_string(ReportKind const &kind);
+
+        // Whether reports of this kind are built at all. Warnings and advice
+        // can be compiled out by defining MJOLNIR_DISABLE_WARNING or
+        // MJOLNIR_DISABLE_ADVICE.
+        [[nodiscard]]
+        constexpr bool is_enabled(BasicReportKind kind) noexcept {
+            switch (kind) {
+                case BasicReportKind::Warning:
+                    return internal::warning_enabled;
+                case BasicReportKind::Advice:
+                    return internal::advice_enabled;
+                default:
+                    return true;
+            }
+        }
     }// namespace report_kind
 
+    // Calls `build` only if reports of `Kind` are enabled. If they are not,
+    // this compiles down to nothing: `build` is never called, so none of the
+    // report it would have put together ends up on the hot path.
+    template<BasicReportKind Kind, std::invocable Build>
+    constexpr void if_enabled(Build &&build) {
+        if constexpr (report_kind::is_enabled(Kind))
+            std::invoke(std::forward<Build>(build));
+    }
+
+// The same, as a statement: `MJOLNIR_IF_ENABLED(Advice) { ... }`.
+#define MJOLNIR_IF_ENABLED(kind)                                               \
+    if constexpr (::mjolnir::report_kind::is_enabled(                          \
+                          ::mjolnir::BasicReportKind::kind                     \
+                  ))
+
     struct ReportConfig final {
-        Characters characters{characters::unicode};
+        std::reference_wrapper<Characters const> characters{
+                characters::unicode
+        };
+        ColorMode                                color_mode{
+                ColorMode::TrueColor
+        };
+        // Optional; reports sharing a cache must not outlive it.
+        SnippetCache                            *snippet_cache{nullptr};
+        // Unlabelled lines shown around each labelled one. Lines inside a
+        // multi-line label that are left out are marked by a gap line.
+        std::size_t                              context_lines{0};
+        // Lines wider than this many bytes are cut down to their labelled
+        // columns. No limit if unset.
+        std::optional<std::size_t>               max_line_width{};
     };
 
     class Report final {
-        ReportKind                 kind_;
-        std::optional<std::string> message_{};
-        std::size_t                start_pos_;
-        Source const              *source_;
+        ReportKind             kind_;
+        std::optional<Message> message_{};
+        std::size_t            start_pos_;
+        Source const          *source_;
 
-        std::optional<std::string> code_;
-        std::vector<std::string>   notes_;
-        std::vector<std::string>   help_;
-        std::vector<Label>         labels_;
-        ReportConfig               config_{};
-
-        [[nodiscard]]
-        std::set<Line> get_lines() const;
+        std::optional<std::pmr::string> code_;
+        std::pmr::vector<Message>       notes_;
+        std::pmr::vector<Message>       help_;
+        std::pmr::vector<Label>         labels_;
+        ReportConfig                    config_{};
 
         friend class ReportPrinter;
 
     public:
-        Report(ReportKind kind, Source const &source, std::size_t start_pos);
+        using allocator_type = std::pmr::polymorphic_allocator<>;
 
-        Report &with_code(std::string code);
+        // Everything the report holds on to, its labels included, is
+        // allocated through `allocator`, and so is the scratch space used
+        // to print it.
+        Report(
+                ReportKind kind, Source const &source, std::size_t start_pos,
+                allocator_type allocator = {}
+        );
 
-        Report &with_message(std::string message);
+        [[nodiscard]]
+        allocator_type get_allocator() const noexcept;
 
-        Report &with_note(std::string note);
+        [[nodiscard]]
+        ReportKind const &get_kind() const noexcept;
 
-        Report &with_help(std::string help);
+        [[nodiscard]]
+        std::optional<std::string_view> get_code() const noexcept;
+
+        [[nodiscard]]
+        std::optional<Message> const &get_message() const noexcept;
+
+        [[nodiscard]]
+        std::span<Label const> get_labels() const noexcept;
+
+        [[nodiscard]]
+        Source const &get_source() const noexcept;
+
+        [[nodiscard]]
+        std::size_t get_start_pos() const noexcept;
+
+        Report &with_kind(ReportKind kind);
+
+        Report &with_code(std::string_view code);
+
+        Report &with_message(std::string_view message);
+
+        // Like with_message, with_note and with_help, but the text is only
+        // formatted once the report is printed.
+        template<typename... Args>
+            requires(sizeof...(Args) > 0)
+        Report &
+        with_message(std::format_string<Args...> format, Args &&...args) {
+            message_.emplace(
+                    get_allocator(), format, std::forward<Args>(args)...
+            );
+            return *this;
+        }
+
+        Report &with_note(std::string_view note);
+
+        template<typename... Args>
+            requires(sizeof...(Args) > 0)
+        Report &with_note(std::format_string<Args...> format, Args &&...args) {
+            notes_.emplace_back(Message{
+                    get_allocator(), format, std::forward<Args>(args)...
+            });
+            return *this;
+        }
+
+        Report &with_help(std::string_view help);
+
+        template<typename... Args>
+            requires(sizeof...(Args) > 0)
+        Report &with_help(std::format_string<Args...> format, Args &&...args) {
+            help_.emplace_back(Message{
+                    get_allocator(), format, std::forward<Args>(args)...
+            });
+            return *this;
+        }
 
         Report &with_label(Label label);
 
         Report &with_config(ReportConfig const &config);
 
         void print(std::ostream &os) const;
+
+        void render_to(Sink &sink) const;
     };
 }// namespace mjolnir
 
@@ -0,0 +1,126 @@
+#ifndef MJOLNIR_SINK_H
+#define MJOLNIR_SINK_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace mjolnir {
+    // Where rendered reports are written to. Reports write many small
+    // pieces, so implementations should keep write() cheap.
+    class Sink {
+    public:
+        Sink() = default;
+
+        Sink(Sink const &) = delete;
+
+        Sink &operator=(Sink const &) = delete;
+
+        virtual ~Sink() = default;
+
+        virtual void write(std::string_view text) = 0;
+
+        // Writes `count` copies of `c`.
+        virtual void fill(char c, std::size_t count);
+
+        // Passes on anything the sink is still holding on to.
+        virtual void flush();
+    };
+
+    Sink &operator<<(Sink &sink, std::string_view text);
+
+    Sink &operator<<(Sink &sink, char c);
+
+    Sink &operator<<(Sink &sink, std::size_t number);
+
+    // Writes straight to the stream's buffer, skipping the formatting and
+    // sentry work every operator<< on the stream itself would do.
+    class OstreamSink final : public Sink {
+        std::ostream *os_;
+
+    public:
+        explicit OstreamSink(std::ostream &os) noexcept;
+
+        void write(std::string_view text) override;
+
+        void flush() override;
+    };
+
+    // Appends to a string owned by the caller.
+    class StringSink final : public Sink {
+        std::string *string_;
+
+    public:
+        explicit StringSink(std::string &string) noexcept;
+
+        void write(std::string_view text) override;
+
+        void fill(char c, std::size_t count) override;
+    };
+
+    // Appends to a string owned by the caller, allocating from its memory
+    // resource.
+    class PmrStringSink final : public Sink {
+        std::pmr::string *string_;
+
+    public:
+        explicit PmrStringSink(std::pmr::string &string) noexcept;
+
+        void write(std::string_view text) override;
+
+        void fill(char c, std::size_t count) override;
+    };
+
+    // Writes into a fixed buffer owned by the caller. Whatever doesn't fit
+    // is dropped, and the sink remembers that it was.
+    class BufferSink final : public Sink {
+        std::span<char> buffer_;
+        std::size_t     size_{0};
+        bool            truncated_{false};
+
+    public:
+        explicit BufferSink(std::span<char> buffer) noexcept;
+
+        void write(std::string_view text) override;
+
+        void fill(char c, std::size_t count) override;
+
+        [[nodiscard]]
+        std::string_view view() const noexcept;
+
+        [[nodiscard]]
+        bool is_truncated() const noexcept;
+    };
+
+    // Buffers output for a file descriptor owned by the caller and writes it
+    // in large chunks. Writes that don't fit the buffer go out together with
+    // it in a single writev. Throws std::system_error if writing fails; the
+    // destructor flushes, but swallows such errors.
+    class FdSink final : public Sink {
+        int                     fd_;
+        std::unique_ptr<char[]> buffer_;
+        std::size_t             capacity_;
+        std::size_t             size_{0};
+
+        void write_out(std::string_view text);
+
+    public:
+        static constexpr std::size_t default_capacity{64 * 1024};
+
+        explicit FdSink(int fd, std::size_t capacity = default_capacity);
+
+        ~FdSink() override;
+
+        void write(std::string_view text) override;
+
+        void fill(char c, std::size_t count) override;
+
+        void flush() override;
+    };
+}// namespace mjolnir
+
+#endif//MJOLNIR_SINK_H
@@ -0,0 +1,61 @@
+#ifndef MJOLNIR_SNIPPET_CACHE_H
+#define MJOLNIR_SNIPPET_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mjolnir {
+    struct CacheStats final {
+        std::size_t hits;
+        std::size_t misses;
+    };
+
+    // Remembers the rendered code snippets of the most recently printed
+    // reports, so a report pointing at the same lines with the same labels
+    // as one before it is printed by copying the earlier output. Reports use
+    // one by way of ReportConfig, and any number of them may share it, from
+    // any thread.
+    class SnippetCache final {
+        struct Entry final {
+            std::string                        key_;
+            std::shared_ptr<std::string const> body_;
+        };
+
+        std::size_t        capacity_;
+        mutable std::mutex mutex_;
+        // most recently used first
+        std::list<Entry>   entries_;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator>
+                                 index_;
+        std::atomic<std::size_t> hits_{0};
+        std::atomic<std::size_t> misses_{0};
+
+    public:
+        // Holds on to at most `capacity` snippets, dropping the least
+        // recently used one to make room.
+        explicit SnippetCache(std::size_t capacity);
+
+        SnippetCache(SnippetCache const &) = delete;
+
+        SnippetCache &operator=(SnippetCache const &) = delete;
+
+        // Shared, so it stays valid even if the entry is evicted meanwhile.
+        [[nodiscard]]
+        std::shared_ptr<std::string const> find(std::string_view key);
+
+        void insert(std::string key, std::shared_ptr<std::string const> body);
+
+        [[nodiscard]]
+        CacheStats get_stats() const noexcept;
+
+        void clear();
+    };
+}// namespace mjolnir
+
+#endif//MJOLNIR_SNIPPET_CACHE_H
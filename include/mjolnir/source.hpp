@@ -2,29 +2,63 @@
 #define MJOLNIR_SOURCE_H
 
 #include <cstdint>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
-#include <set>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "color.hpp"
+#include "message.hpp"
+#include "sink.hpp"
 #include "span.hpp"
 
 namespace mjolnir {
     struct LabelDisplay final {
-        std::optional<std::string> message_;
-        std::optional<Color>       color_{};
+        std::optional<Message> message_;
+        std::optional<Color>   color_{};
+
+        void print(
+                Sink &sink, std::string_view message,
+                ColorMode mode = ColorMode::TrueColor
+        ) const;
 
         void print(std::ostream &os, std::string_view message) const;
     };
 
     class Label final {
-        Span         span_;
-        LabelDisplay display_{};
+        Span                       span_;
+        LabelDisplay               display_{};
+        std::pmr::memory_resource *resource_;
 
     public:
-        explicit Label(Span const &span);
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        explicit Label(Span const &span, allocator_type allocator = {});
+
+        // Like a Message, a copy uses the default memory resource.
+        Label(Label const &other);
+
+        Label(Label &&other) noexcept = default;
+
+        // Lets containers using a polymorphic allocator hand theirs down.
+        Label(Label const &other, allocator_type allocator);
+
+        Label(Label &&other, allocator_type allocator);
+
+        // Assigning keeps the label's own memory resource.
+        Label &operator=(Label const &other);
+
+        Label &operator=(Label &&other);
+
+        [[nodiscard]]
+        allocator_type get_allocator() const noexcept;
 
         [[nodiscard]]
         Span const &get_span() const noexcept;
@@ -32,7 +66,18 @@ namespace mjolnir {
         [[nodiscard]]
         LabelDisplay const &get_display() const noexcept;
 
-        Label &with_message(std::string message);
+        Label &with_message(std::string_view message);
+
+        // Formats the message only once the label is printed.
+        template<typename... Args>
+            requires(sizeof...(Args) > 0)
+        Label &
+        with_message(std::format_string<Args...> format, Args &&...args) {
+            display_.message_.emplace(
+                    get_allocator(), format, std::forward<Args>(args)...
+            );
+            return *this;
+        }
 
         Label &with_color(Color color);
 
@@ -63,8 +108,8 @@ namespace mjolnir {
 
     namespace internal {
         struct SpannedLine final {
-            Line                  line_;
-            std::set<ColoredSpan> spans_;
+            Line                         line_;
+            std::span<ColoredSpan const> spans_;
 
             [[nodiscard]]
             bool operator==(SpannedLine const &other) const;
@@ -78,19 +123,197 @@ namespace mjolnir {
             [[nodiscard]]
             std::size_t max_span_end() const;
         };
+
+        // Copying or moving the owner hands out a fresh, unlocked mutex.
+        struct IndexMutex final : std::mutex {
+            IndexMutex() = default;
+
+            IndexMutex(IndexMutex const &) noexcept {
+            }
+
+            IndexMutex &operator=(IndexMutex const &) noexcept {
+                return *this;
+            }
+        };
+
+        // Line start offsets stored as 32-bit deltas from the base of the
+        // block they're in. A new block is only started once a delta no
+        // longer fits, so buffers under 4 GiB are a single block of plain
+        // 32-bit offsets.
+        class CompactLineIndex final {
+            struct Block final {
+                std::size_t base_;
+                std::size_t first_line_;
+            };
+
+            std::vector<Block>         blocks_;
+            std::vector<std::uint32_t> deltas_;
+
+        public:
+            void push_back(std::size_t line_start);
+
+            void truncate(std::size_t line_count);
+
+            void shrink_to_fit();
+
+            [[nodiscard]]
+            std::size_t size() const noexcept;
+
+            [[nodiscard]]
+            bool empty() const noexcept;
+
+            [[nodiscard]]
+            std::size_t operator[](std::size_t line) const noexcept;
+
+            // Returns the number of lines that start at or before `offset`.
+            [[nodiscard]]
+            std::size_t count_starting_at_or_before(std::size_t offset
+            ) const noexcept;
+        };
+
+        // Maps every 2^shift_ bytes of a buffer to the line they start in,
+        // so a lookup only searches the few lines between two neighbouring
+        // entries rather than the whole line table.
+        struct LineJumpTable final {
+            static constexpr std::size_t lines_per_bucket{8};
+
+            std::size_t              shift_{0};
+            std::vector<std::size_t> first_lines_;
+        };
     }// namespace internal
 
+    enum class Indexing {
+        // The whole line table is built when the Source is constructed.
+        Eager,
+        // Lines are only indexed up to the highest offset looked up so far.
+        Lazy
+    };
+
+    enum class LineTable {
+        // A Line per line, 24 bytes each.
+        Full,
+        // Only line starts, 4 bytes each; Lines are rebuilt on lookup.
+        Compact
+    };
+
+    enum class ColumnUnit {
+        // Columns count bytes, like clang reports them.
+        Byte,
+        // Columns count UTF-8 code points, like rustc reports them.
+        CodePoint,
+        // Like CodePoint, but a tab advances to the next tab stop, like gcc
+        // reports them.
+        Display
+    };
+
+    struct ColumnMode final {
+        ColumnUnit  unit_{ColumnUnit::CodePoint};
+        std::size_t tab_width_{8};
+    };
+
+    // A 1-based line and column, as reported by most tools.
+    struct LineColumn final {
+        std::size_t line_;
+        std::size_t column_;
+    };
+
     class Source final {
-        std::string       name_;
-        std::string_view  buffer_;
-        std::vector<Line> lines_;
+        static constexpr std::size_t lazy_chunk_size{64 * 1024};
+
+        std::string                        name_;
+        std::shared_ptr<void const>        storage_{};
+        std::shared_ptr<std::string>       edit_buffer_{};
+        std::string_view                   buffer_;
+        Indexing                           indexing_;
+        LineTable                          line_table_;
+        mutable std::vector<Line>          lines_;
+        mutable internal::CompactLineIndex compact_lines_;
+        mutable std::size_t                scanned_{0};
+        mutable std::size_t                open_line_start_{0};
+        mutable internal::IndexMutex       index_mutex_;
+        internal::LineJumpTable            jump_table_;
+        std::uint64_t                      revision_;
+
+        void index_through(std::size_t offset) const;
+
+        [[nodiscard]]
+        std::optional<Line> find_line_info(std::size_t offset) const;
+
+        [[nodiscard]]
+        Line get_compact_line(std::size_t index) const noexcept;
+
+        [[nodiscard]]
+        std::size_t line_count() const noexcept;
+
+        [[nodiscard]]
+        std::size_t get_line_start(std::size_t index) const noexcept;
+
+        [[nodiscard]]
+        Line get_indexed_line(std::size_t index) const noexcept;
+
+        void index_lines(std::size_t count) const;
+
+        [[nodiscard]]
+        std::optional<std::size_t>
+        find_offset(LineColumn const &position, ColumnMode const &mode) const;
+
+        // Resolves offsets into lines, the slot for each offset having been
+        // value-initialized by the caller; order is scratch space.
+        void resolve_into(
+                std::span<std::size_t const> offsets,
+                std::span<std::size_t> order,
+                std::span<std::optional<Line>> lines
+        ) const;
+
+        void apply_full_edit(
+                Span const &replaced, std::size_t text_size, bool fully_indexed
+        );
+
+        void apply_compact_edit(std::size_t start);
+
+        // What the copy and move constructors delegate to, with `other`'s
+        // index locked for as long as it is being read.
+        Source(Source const &other, std::lock_guard<std::mutex> const &lock);
+
+        Source(
+                Source &&other, std::lock_guard<std::mutex> const &lock
+        ) noexcept;
 
     public:
-        Source(std::string name, std::string_view buffer);
+        Source(
+                std::string name, std::string_view buffer,
+                Indexing  indexing   = Indexing::Eager,
+                LineTable line_table = LineTable::Full
+        );
+
+        // A lazy source may be indexing more lines on another thread, so
+        // copying or moving one takes the lock on its index.
+        Source(Source const &other);
+
+        Source(Source &&other) noexcept;
+
+        Source &operator=(Source const &other);
+
+        Source &operator=(Source &&other) noexcept;
+
+        // Maps the file at `path` into memory instead of requiring the caller
+        // to read it and keep the buffer alive. The mapping is owned by the
+        // returned Source and shared between its copies.
+        [[nodiscard]]
+        static Source from_file(
+                std::filesystem::path const &path,
+                Indexing                     indexing   = Indexing::Eager,
+                LineTable                    line_table = LineTable::Full
+        );
 
         [[nodiscard]]
         std::string_view get_name() const noexcept;
 
+        // Identifies the contents of the source: no two sources share one
+        // unless one is a copy of the other, and it changes with every edit.
+        [[nodiscard]]
+        std::uint64_t get_revision() const noexcept;
+
         [[nodiscard]]
         std::optional<std::string_view> get_line(std::size_t offset) const;
 
@@ -103,8 +326,50 @@ namespace mjolnir {
         [[nodiscard]]
         std::optional<Line> get_line_info(std::size_t offset) const;
 
+        // Looks up the lines of many offsets at once, in the order given.
+        // The offsets are sorted and resolved in one forward pass over the
+        // line table, galloping ahead from one result to the next.
+        [[nodiscard]]
+        std::vector<std::optional<Line>>
+        resolve(std::span<std::size_t const> offsets) const;
+
+        [[nodiscard]]
+        std::pmr::vector<std::optional<Line>> resolve(
+                std::span<std::size_t const> offsets,
+                std::pmr::polymorphic_allocator<> allocator
+        ) const;
+
         [[nodiscard]]
         std::size_t size() const noexcept;
+
+        // Turns a line and column, e.g. from another tool's diagnostic, back
+        // into a byte offset. A column may point one past the end of its
+        // line; anything further, or a line that doesn't exist, yields
+        // std::nullopt.
+        [[nodiscard]]
+        std::optional<std::size_t> offset_of(
+                std::size_t line, std::size_t column, ColumnMode const &mode = {}
+        ) const;
+
+        [[nodiscard]]
+        std::vector<std::optional<std::size_t>> offsets_of(
+                std::span<LineColumn const> positions,
+                ColumnMode const           &mode = {}
+        ) const;
+
+        // Builds a table that lets lookups jump straight to a handful of
+        // candidate lines instead of binary searching the whole line table,
+        // at about a byte per line. Worth it for sources that get a lot of
+        // lookups. Fully indexes a lazy source, and is kept up to date by
+        // apply_edit.
+        void build_lookup_table();
+
+        // Replaces the bytes covered by `replaced` with `text` and patches
+        // the line table to match, rescanning only the lines the edit
+        // touches. The first edit copies the buffer into storage owned by the
+        // Source, after which the original buffer is no longer referenced.
+        // A compact line table is reindexed from the edited line onwards.
+        void apply_edit(Span const &replaced, std::string_view text);
     };
 }// namespace mjolnir
 
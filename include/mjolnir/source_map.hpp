@@ -0,0 +1,59 @@
+#ifndef MJOLNIR_SOURCE_MAP_H
+#define MJOLNIR_SOURCE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "source.hpp"
+#include "span.hpp"
+
+namespace mjolnir {
+    struct SourceLocation final {
+        Source const *source_;
+        std::size_t   offset_;
+        Line          line_;
+        std::size_t   column_;
+    };
+
+    // Lays sources out back to back in one 32-bit offset space, so that a
+    // position in any of them fits in a single integer.
+    class SourceMap final {
+    public:
+        using Offset = std::uint32_t;
+
+    private:
+        // Parallel to each other; the bases are kept apart so the binary
+        // search over them doesn't drag whole Sources through the cache.
+        std::vector<Offset> bases_;
+        std::deque<Source>  sources_;
+        Offset              next_base_{0};
+
+        [[nodiscard]]
+        std::optional<std::size_t> find_index(Offset offset) const noexcept;
+
+    public:
+        // Registers a source and returns the global offset its first byte
+        // maps to. Every source also reserves one offset past its end, so
+        // end-of-file positions never alias the next source.
+        Offset add(Source source);
+
+        [[nodiscard]]
+        std::size_t size() const noexcept;
+
+        [[nodiscard]]
+        Source const *get_source(Offset offset) const noexcept;
+
+        [[nodiscard]]
+        std::optional<SourceLocation> resolve(Offset offset) const;
+
+        // Converts a global span into one local to the source it's in,
+        // throwing if it isn't contained in a single source.
+        [[nodiscard]]
+        Span to_local(Offset start, Offset end) const;
+    };
+}// namespace mjolnir
+
+#endif//MJOLNIR_SOURCE_MAP_H
@@ -2,6 +2,7 @@
 #define MJOLNIR_SPAN_H
 
 #include <cstdint>
+#include <functional>
 
 namespace mjolnir {
     class Label;
@@ -52,6 +53,9 @@ namespace mjolnir {
         struct ColoredSpan final {
             Span         span_;
             Label const *label_ptr_;
+            // Part of a label spanning several lines, which is drawn in the
+            // gutter rather than underlined.
+            bool         multiline_{false};
 
             [[nodiscard]]
             bool operator==(ColoredSpan const &other) const;
@@ -64,12 +68,13 @@ namespace mjolnir {
 
             [[nodiscard]]
             bool is_highlight() const;
-
-            [[nodiscard]]
-            bool
-            is_single_line_highlightable(Source const &source) const noexcept;
         };
     }// namespace internal
 }// namespace mjolnir
 
+template<>
+struct std::hash<mjolnir::Span> {
+    std::size_t operator()(mjolnir::Span const &span) const noexcept;
+};
+
 #endif//MJOLNIR_SPAN_H
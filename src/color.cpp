@@ -1,35 +1,21 @@
-#include <format>           // for format
 #include <mjolnir/color.hpp>// for Color
-#include <sstream>          // for char_traits, basic_ostream, basic_strin...
-#include <string>           // for allocator, operator<<, string
-#include <string_view>      // for operator<<, string_view
+#include <string>           // for string
+#include <string_view>      // for string_view
 
 namespace mjolnir {
     std::string Color::fg(std::string_view message) const {
-        std::stringstream ss;
+        std::string colored;
+        colored.reserve(fg_start().size() + message.size() + end.size());
 
-        ss << fg_start() << message << end;
-        return ss.str();
+        colored.append(fg_start()).append(message).append(end);
+        return colored;
     }
 
     std::string Color::bg(std::string_view message) const {
-        std::stringstream ss;
+        std::string colored;
+        colored.reserve(bg_start().size() + message.size() + end.size());
 
-        ss << bg_start() << message << end;
-        return ss.str();
-    }
-
-    std::string Color::fg_start() const {
-        return std::format(
-                "\033[38;2;{};{};{}m", static_cast<int>(r_),
-                static_cast<int>(g_), static_cast<int>(b_)
-        );
-    }
-
-    std::string Color::bg_start() const {
-        return std::format(
-                "\033[48;2;{};{};{}m", static_cast<int>(r_),
-                static_cast<int>(g_), static_cast<int>(b_)
-        );
+        colored.append(bg_start()).append(message).append(end);
+        return colored;
     }
 }// namespace mjolnir
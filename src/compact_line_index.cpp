@@ -0,0 +1,80 @@
+#include <algorithm>         // for upper_bound
+#include <cstddef>           // for size_t
+#include <cstdint>           // for uint32_t
+#include <iterator>          // for next, prev
+#include <limits>            // for numeric_limits
+#include <mjolnir/source.hpp>// for CompactLineIndex
+#include <vector>            // for vector
+
+namespace mjolnir::internal {
+    void CompactLineIndex::push_back(std::size_t line_start) {
+        if (blocks_.empty() || line_start - blocks_.back().base_ >
+                                       std::numeric_limits<std::uint32_t>::max()) {
+            blocks_.emplace_back(
+                    Block{.base_ = line_start, .first_line_ = deltas_.size()}
+            );
+        }
+
+        deltas_.emplace_back(
+                static_cast<std::uint32_t>(line_start - blocks_.back().base_)
+        );
+    }
+
+    void CompactLineIndex::truncate(std::size_t line_count) {
+        if (line_count >= deltas_.size())
+            return;
+
+        deltas_.resize(line_count);
+        while (!blocks_.empty() && blocks_.back().first_line_ >= line_count) {
+            blocks_.pop_back();
+        }
+    }
+
+    void CompactLineIndex::shrink_to_fit() {
+        blocks_.shrink_to_fit();
+        deltas_.shrink_to_fit();
+    }
+
+    std::size_t CompactLineIndex::size() const noexcept {
+        return deltas_.size();
+    }
+
+    bool CompactLineIndex::empty() const noexcept {
+        return deltas_.empty();
+    }
+
+    std::size_t CompactLineIndex::operator[](std::size_t line) const noexcept {
+        auto const block{std::prev(std::ranges::upper_bound(
+                blocks_, line, {}, &Block::first_line_
+        ))};
+
+        return block->base_ + deltas_[line];
+    }
+
+    std::size_t
+    CompactLineIndex::count_starting_at_or_before(std::size_t offset
+    ) const noexcept {
+        auto block{std::ranges::upper_bound(blocks_, offset, {}, &Block::base_)};
+        if (block == blocks_.cbegin())
+            return 0;
+
+        auto const block_end{
+                block == blocks_.cend() ? deltas_.cend()
+                                        : std::next(deltas_.cbegin(),
+                                                    block->first_line_)
+        };
+        --block;
+
+        // Every delta in the block fits 32 bits, so anything past that lies
+        // beyond the block and the comparison can be clamped.
+        auto const delta{static_cast<std::uint32_t>(std::min<std::size_t>(
+                offset - block->base_, std::numeric_limits<std::uint32_t>::max()
+        ))};
+        auto const it{std::upper_bound(
+                std::next(deltas_.cbegin(), block->first_line_), block_end,
+                delta
+        )};
+
+        return static_cast<std::size_t>(std::distance(deltas_.cbegin(), it));
+    }
+}// namespace mjolnir::internal
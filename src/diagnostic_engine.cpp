@@ -0,0 +1,498 @@
+#include "mjolnir/diagnostic_engine.hpp"// for DiagnosticEngine
+
+#include <algorithm>    // for sort, find, find_if, equal
+#include <atomic>       // for memory_order
+#include <cstddef>      // for size_t
+#include <exception>    // for exception_ptr, current_exception, rethrow_...
+#include <functional>   // for hash
+#include <limits>       // for numeric_limits
+#include <mutex>        // for lock_guard, unique_lock
+#include <optional>     // for optional, nullopt, in_place
+#include <stop_token>   // for stop_token, stop_callback
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <tuple>        // for tuple
+#include <unordered_map>// for unordered_map
+#include <utility>      // for move, swap, exchange
+#include <variant>      // for get_if, get
+#include <vector>       // for vector
+
+#include "mjolnir/message.hpp"// for Message, hash
+#include "mjolnir/report.hpp" // for Report, BasicReportKind, ReportKind, is_...
+#include "mjolnir/sink.hpp"   // for Sink, StringSink
+#include "mjolnir/source.hpp" // for Source, Label
+#include "mjolnir/span.hpp"   // for Span, hash
+
+namespace mjolnir {
+    namespace {
+        void hash_combine(std::size_t &seed, std::size_t hash) noexcept {
+            seed ^= hash + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+        }
+
+        // Hashes what makes two reports duplicates of each other: their
+        // source, kind, code, message, and the spans and messages of their
+        // labels. Nothing gets laid out or rendered for it.
+        std::size_t identity_hash(Report const &report) {
+            std::size_t seed{std::hash<Source const *>{}(&report.get_source())};
+
+            auto const &kind{report.get_kind()};
+            hash_combine(seed, kind.index());
+            if (auto const *basic{std::get_if<BasicReportKind>(&kind)})
+                hash_combine(seed, static_cast<std::size_t>(*basic));
+            else
+                hash_combine(
+                        seed, std::hash<std::string_view>{}(
+                                      std::get<CustomReportKind>(kind).name
+                              )
+                );
+
+            if (auto const code{report.get_code()})
+                hash_combine(seed, std::hash<std::string_view>{}(*code));
+
+            if (auto const &message{report.get_message()})
+                hash_combine(seed, std::hash<Message>{}(*message));
+
+            for (auto const &label : report.get_labels()) {
+                hash_combine(seed, std::hash<Span>{}(label.get_span()));
+
+                if (auto const &message{label.get_display().message_})
+                    hash_combine(seed, std::hash<Message>{}(*message));
+            }
+
+            return seed;
+        }
+
+        // Whether two reports are duplicates of each other, as far as the
+        // parts identity_hash looks at go; for when their hashes match.
+        bool same_identity(Report const &lhs, Report const &rhs) {
+            auto const same_kind{[&] {
+                auto const &a{lhs.get_kind()};
+                auto const &b{rhs.get_kind()};
+                if (a.index() != b.index())
+                    return false;
+
+                if (auto const *basic{std::get_if<BasicReportKind>(&a)})
+                    return *basic == std::get<BasicReportKind>(b);
+
+                return std::get<CustomReportKind>(a).name ==
+                       std::get<CustomReportKind>(b).name;
+            }};
+
+            auto const same_label{[](Label const &a, Label const &b) {
+                return a.get_span() == b.get_span() &&
+                       a.get_display().message_ == b.get_display().message_;
+            }};
+
+            return &lhs.get_source() == &rhs.get_source() && same_kind() &&
+                   lhs.get_code() == rhs.get_code() &&
+                   lhs.get_message() == rhs.get_message() &&
+                   std::ranges::equal(
+                           lhs.get_labels(), rhs.get_labels(), same_label
+                   );
+        }
+
+        // The entry among `occurrences` for reports like `report`, or their
+        // end if there is none yet.
+        template<typename Occurrences>
+        auto find_occurrence(
+                Occurrences &occurrences, std::size_t hash,
+                Report const &report
+        ) {
+            auto const [first, last]{occurrences.equal_range(hash)};
+            auto const it{std::find_if(first, last, [&](auto const &entry) {
+                return same_identity(entry.second.report_, report);
+            })};
+
+            return it == last ? occurrences.end() : it;
+        }
+    }// namespace
+
+    DiagnosticEngine::DiagnosticEngine(Sink &sink, EngineConfig const &config)
+        : sink_{&sink}
+        , backpressure_{config.backpressure}
+        , policy_{config.policy}
+        , queue_{config.queue_capacity}
+        , collected_capacity_{config.queue_capacity}
+        , write_full_batches_{config.write_full_batches} {
+        collected_.reserve(collected_capacity_);
+
+        // the thread calling flush() lends a hand, so it counts as one
+        workers_.reserve(config.workers > 0 ? config.workers - 1 : 0);
+        for (std::size_t i{1}; i < config.workers; ++i) {
+            workers_.emplace_back([this](std::stop_token const &stop) {
+                work(stop);
+            });
+        }
+
+        collector_ = std::jthread{[this](std::stop_token const &stop) {
+            collect(stop);
+        }};
+    }
+
+    DiagnosticEngine::~DiagnosticEngine() {
+        try {
+            flush();
+        } catch (...) {
+            // nowhere left to report it
+        }
+    }
+
+    ReportKind DiagnosticEngine::promote(ReportKind const &kind
+    ) const noexcept {
+        if (auto const *basic{std::get_if<BasicReportKind>(&kind)};
+            basic != nullptr && *basic == BasicReportKind::Warning &&
+            policy_.warnings_as_errors)
+            return BasicReportKind::Error;
+
+        return kind;
+    }
+
+    bool DiagnosticEngine::counts_as_error(ReportKind const &kind
+    ) const noexcept {
+        auto const *basic{std::get_if<BasicReportKind>(&kind)};
+        return basic != nullptr && *basic == BasicReportKind::Error;
+    }
+
+    bool DiagnosticEngine::keeps_counts() const noexcept {
+        return policy_.max_errors.has_value() ||
+               policy_.max_per_code.has_value() || policy_.deduplicate;
+    }
+
+    bool DiagnosticEngine::is_suppressed(
+            ReportKind const &kind, std::optional<std::string_view> code
+    ) const noexcept {
+        if (auto const *basic{std::get_if<BasicReportKind>(&kind)};
+            basic != nullptr &&
+            (!report_kind::is_enabled(*basic) ||
+             std::ranges::find(policy_.suppressed_kinds, *basic) !=
+                     policy_.suppressed_kinds.end()))
+            return true;
+
+        return code.has_value() &&
+               std::ranges::find(policy_.suppressed_codes, *code) !=
+                       policy_.suppressed_codes.end();
+    }
+
+    bool DiagnosticEngine::would_emit(
+            ReportKind const &kind, std::optional<std::string_view> code
+    ) const {
+        auto const promoted{promote(kind)};
+        if (is_suppressed(promoted, code))
+            return false;
+
+        if (policy_.max_errors.has_value() && counts_as_error(promoted) &&
+            errors_.load(std::memory_order_relaxed) >= *policy_.max_errors)
+            return false;
+
+        if (!policy_.max_per_code.has_value() || !code.has_value())
+            return true;
+
+        std::lock_guard const lock{counts_mutex_};
+        auto const            it{code_counts_.find(*code)};
+        return it == code_counts_.end() || it->second < *policy_.max_per_code;
+    }
+
+    std::optional<Report> DiagnosticEngine::make_report(
+            ReportKind kind, Source const &source, std::size_t start_pos,
+            std::optional<std::string_view> code,
+            Report::allocator_type          allocator
+    ) const {
+        if (!would_emit(kind, code))
+            return std::nullopt;
+
+        std::optional<Report> report{
+                std::in_place, std::move(kind), source, start_pos, allocator
+        };
+        if (code.has_value())
+            report->with_code(*code);
+
+        return report;
+    }
+
+    bool DiagnosticEngine::submit(Report report) {
+        // Warnings are promoted before anything else, so that a promoted
+        // warning is suppressed or limited as the error it now is.
+        report.with_kind(promote(report.get_kind()));
+
+        auto const code{report.get_code()};
+        if (is_suppressed(report.get_kind(), code))
+            return false;
+
+        // The budget is taken up front, so that concurrent submits can't
+        // overshoot it, and given back for reports the queue drops. Without
+        // limits or deduplication, there is nothing to count, nor to lock.
+        if (keeps_counts() && !take_budget(report))
+            return false;
+
+        if (!queue_.push(
+                    std::move(report), backpressure_,
+                    [this](Report &&dropped) { release_budget(dropped); }
+            ))
+            return false;
+
+        pushes_.fetch_add(1, std::memory_order_release);
+        pushes_.notify_one();
+        return true;
+    }
+
+    bool DiagnosticEngine::take_budget(Report const &report) {
+        auto const code{report.get_code()};
+
+        std::optional<std::size_t> identity{};
+        if (policy_.deduplicate)
+            identity = identity_hash(report);
+
+        bool const is_error{counts_as_error(report.get_kind())};
+
+        std::lock_guard const lock{counts_mutex_};
+
+        // A duplicate is dropped before it can take from the limits.
+        if (identity.has_value()) {
+            if (auto const it{find_occurrence(occurrences_, *identity, report)};
+                it != occurrences_.end()) {
+                ++it->second.count_;
+                return false;
+            }
+        }
+
+        auto const errors{errors_.load(std::memory_order_relaxed)};
+        if (is_error && policy_.max_errors.has_value() &&
+            errors >= *policy_.max_errors)
+            return false;
+
+        if (code.has_value() && policy_.max_per_code.has_value()) {
+            auto it{code_counts_.find(*code)};
+            if (it == code_counts_.end())
+                it = code_counts_.emplace(std::string{*code}, 0).first;
+
+            if (it->second >= *policy_.max_per_code)
+                return false;
+
+            ++it->second;
+        }
+
+        if (is_error)
+            errors_.store(errors + 1, std::memory_order_relaxed);
+
+        if (identity.has_value())
+            occurrences_.emplace(
+                    *identity, Occurrence{.report_ = report, .count_ = 1}
+            );
+
+        return true;
+    }
+
+    void DiagnosticEngine::release_budget(Report const &report) {
+        if (!keeps_counts())
+            return;
+
+        std::lock_guard const lock{counts_mutex_};
+
+        if (counts_as_error(report.get_kind()))
+            errors_.fetch_sub(1, std::memory_order_relaxed);
+
+        if (auto const code{report.get_code()};
+            code.has_value() && policy_.max_per_code.has_value()) {
+            if (auto const it{code_counts_.find(*code)};
+                it != code_counts_.end())
+                --it->second;
+        }
+
+        // so that the next report like it is let through in its place
+        if (policy_.deduplicate) {
+            if (auto const it{find_occurrence(
+                        occurrences_, identity_hash(report), report
+                )};
+                it != occurrences_.end())
+                occurrences_.erase(it);
+        }
+    }
+
+    QueueStats DiagnosticEngine::get_queue_stats() const noexcept {
+        return queue_.get_stats();
+    }
+
+    bool DiagnosticEngine::drain_queue(std::size_t limit) {
+        std::lock_guard const lock{collected_mutex_};
+
+        while (collected_.size() < limit) {
+            auto report{queue_.try_pop()};
+            if (!report.has_value())
+                return false;
+
+            collected_.emplace_back(std::move(*report));
+        }
+
+        return true;
+    }
+
+    void DiagnosticEngine::collect(std::stop_token const &stop) {
+        std::stop_callback const wake{stop, [this] {
+            pushes_.fetch_add(1, std::memory_order_release);
+            pushes_.notify_one();
+        }};
+
+        while (true) {
+            auto const seen{pushes_.load(std::memory_order_acquire)};
+            bool const full{drain_queue(collected_capacity_)};
+
+            // Checked only after loading `seen`: a stop requested any later
+            // bumps pushes_ past it, so the wait can't miss it.
+            if (stop.stop_requested())
+                break;
+
+            // A full batch waits for the next flush, the queue filling up
+            // behind it, unless the collector is to write it out itself.
+            if (full && write_full_batches_) {
+                std::lock_guard const flush_lock{flush_mutex_};
+
+                // Whatever the sink throws, or a note that couldn't be
+                // allocated, waits for the next flush too, rather than
+                // escaping the thread and terminating the program.
+                std::exception_ptr error{};
+                try {
+                    error = write_out();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                if (error != nullptr && deferred_error_ == nullptr)
+                    deferred_error_ = error;
+
+                continue;
+            }
+
+            pushes_.wait(seen, std::memory_order_acquire);
+        }
+
+        drain_queue(collected_capacity_);
+    }
+
+    void DiagnosticEngine::render_batch() {
+        for (auto index{next_.fetch_add(1)}; index < batch_.size();
+             index = next_.fetch_add(1)) {
+            auto &rendered{batch_[index]};
+
+            try {
+                StringSink sink{rendered.text_};
+                rendered.report_.render_to(sink);
+            } catch (...) {
+                rendered.error_ = std::current_exception();
+            }
+        }
+    }
+
+    void DiagnosticEngine::work(std::stop_token const &stop) {
+        std::size_t seen{0};
+
+        while (true) {
+            {
+                std::unique_lock lock{pool_mutex_};
+                if (!work_ready_.wait(lock, stop, [&] {
+                        return generation_ != seen;
+                    }))
+                    return;
+
+                seen = generation_;
+            }
+
+            render_batch();
+
+            std::lock_guard const lock{pool_mutex_};
+            if (--busy_ == 0)
+                work_done_.notify_all();
+        }
+    }
+
+    void DiagnosticEngine::note_duplicates(std::vector<Report> &reports
+    ) const {
+        std::lock_guard const lock{counts_mutex_};
+
+        for (auto &report : reports) {
+            auto const it{
+                    find_occurrence(occurrences_, identity_hash(report), report)
+            };
+            if (it == occurrences_.end() || it->second.count_ < 2)
+                continue;
+
+            if (auto const more{it->second.count_ - 1}; more == 1)
+                report.with_note("(1 more occurrence)");
+            else
+                report.with_note("({} more occurrences)", more);
+        }
+    }
+
+    void DiagnosticEngine::flush() {
+        std::lock_guard const flush_lock{flush_mutex_};
+
+        auto error{std::exchange(deferred_error_, nullptr)};
+        if (auto const batch_error{write_out()}; error == nullptr)
+            error = batch_error;
+
+        if (error != nullptr)
+            std::rethrow_exception(error);
+    }
+
+    std::exception_ptr DiagnosticEngine::write_out() {
+        // whatever the collector hasn't gotten to yet still belongs in here
+        drain_queue(std::numeric_limits<std::size_t>::max());
+
+        std::vector<Report> reports;
+        {
+            std::lock_guard const lock{collected_mutex_};
+            std::swap(reports, collected_);
+            collected_.reserve(collected_capacity_);
+        }
+
+        if (reports.empty())
+            return nullptr;
+
+        if (policy_.deduplicate && policy_.note_duplicates)
+            note_duplicates(reports);
+
+        std::vector<Rendered> batch;
+        batch.reserve(reports.size());
+        for (auto &report : reports) {
+            batch.emplace_back(Rendered{.report_ = std::move(report)});
+        }
+
+        {
+            std::lock_guard const lock{pool_mutex_};
+            batch_ = batch;
+            next_  = 0;
+            busy_  = workers_.size();
+            ++generation_;
+        }
+        work_ready_.notify_all();
+
+        render_batch();
+        {
+            std::unique_lock lock{pool_mutex_};
+            work_done_.wait(lock, [&] { return busy_ == 0; });
+            batch_ = {};
+        }
+
+        std::ranges::sort(batch, {}, [](Rendered const &rendered) {
+            return std::tuple{
+                    rendered.report_.get_source().get_name(),
+                    rendered.report_.get_start_pos(),
+                    std::string_view{rendered.text_}
+            };
+        });
+
+        std::exception_ptr error{};
+        for (auto const &rendered : batch) {
+            if (rendered.error_ != nullptr) {
+                if (error == nullptr)
+                    error = rendered.error_;
+
+                continue;
+            }
+
+            sink_->write(rendered.text_);
+        }
+        sink_->flush();
+
+        return error;
+    }
+}// namespace mjolnir
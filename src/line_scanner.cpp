@@ -0,0 +1,255 @@
+#include "line_scanner.h"
+
+#include <algorithm>  // for max
+#include <bit>        // for countr_zero, popcount
+#include <cstdint>    // for uint32_t
+#include <cstring>    // for memchr
+#include <string_view>// for string_view
+#include <vector>     // for vector
+
+#include "mjolnir/source.hpp"// for Line
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MJOLNIR_SCAN_X86
+#include <immintrin.h>// for _mm256_*, _mm_*
+#endif
+
+namespace mjolnir::internal {
+    namespace {
+        using CountFn = std::size_t (*)(char const *, std::size_t);
+        using ScanFn  = std::size_t (*)(
+                std::string_view, std::size_t, std::size_t, std::size_t,
+                std::vector<Line> &
+        );
+
+        struct Kernels final {
+            CountFn count_;
+            ScanFn  scan_;
+        };
+
+        void emit_line(
+                std::vector<Line> &lines, std::size_t &line_start,
+                std::size_t newline
+        ) {
+            lines.emplace_back(
+                    Line{.byte_offset_ = line_start,
+                         .byte_length_ = newline - line_start,
+                         .line_number_ = lines.size() + 1}
+            );
+            line_start = newline + 1;
+        }
+
+        std::size_t count_newlines_scalar(char const *data, std::size_t size) {
+            std::size_t count{0};
+            for (std::size_t i{0}; i < size; ++i) count += data[i] == '\n';
+
+            return count;
+        }
+
+        std::size_t scan_lines_scalar(
+                std::string_view buffer, std::size_t line_start,
+                std::size_t begin, std::size_t end, std::vector<Line> &lines
+        ) {
+            auto const data{buffer.data()};
+
+            for (auto pos{begin}; pos < end;) {
+                auto const found{static_cast<char const *>(
+                        std::memchr(data + pos, '\n', end - pos)
+                )};
+                if (found == nullptr)
+                    break;
+
+                auto const newline{static_cast<std::size_t>(found - data)};
+                emit_line(lines, line_start, newline);
+                pos = newline + 1;
+            }
+
+            return line_start;
+        }
+
+#ifdef MJOLNIR_SCAN_X86
+        [[gnu::target("sse2")]]
+        std::size_t count_newlines_sse2(char const *data, std::size_t size) {
+            constexpr std::size_t block_size{16};
+
+            auto const  needle{_mm_set1_epi8('\n')};
+            std::size_t count{0};
+            std::size_t pos{0};
+
+            for (; pos + block_size <= size; pos += block_size) {
+                auto const block{_mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(data + pos)
+                )};
+                count += std::popcount(static_cast<std::uint32_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle))
+                ));
+            }
+
+            return count + count_newlines_scalar(data + pos, size - pos);
+        }
+
+        [[gnu::target("sse2")]]
+        std::size_t scan_lines_sse2(
+                std::string_view buffer, std::size_t line_start,
+                std::size_t begin, std::size_t end, std::vector<Line> &lines
+        ) {
+            constexpr std::size_t block_size{16};
+
+            auto const data{buffer.data()};
+            auto const needle{_mm_set1_epi8('\n')};
+            auto       pos{begin};
+
+            for (; pos + block_size <= end; pos += block_size) {
+                auto const block{_mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(data + pos)
+                )};
+                auto mask{static_cast<std::uint32_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle))
+                )};
+
+                while (mask != 0) {
+                    emit_line(lines, line_start, pos + std::countr_zero(mask));
+                    mask &= mask - 1;
+                }
+            }
+
+            for (; pos < end; ++pos) {
+                if (data[pos] == '\n')
+                    emit_line(lines, line_start, pos);
+            }
+
+            return line_start;
+        }
+
+        [[gnu::target("avx2,popcnt")]]
+        std::size_t count_newlines_avx2(char const *data, std::size_t size) {
+            constexpr std::size_t block_size{32};
+
+            auto const  needle{_mm256_set1_epi8('\n')};
+            std::size_t count{0};
+            std::size_t pos{0};
+
+            for (; pos + block_size <= size; pos += block_size) {
+                auto const block{_mm256_loadu_si256(
+                        reinterpret_cast<__m256i const *>(data + pos)
+                )};
+                count += std::popcount(static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle))
+                ));
+            }
+
+            return count + count_newlines_scalar(data + pos, size - pos);
+        }
+
+        [[gnu::target("avx2")]]
+        std::size_t scan_lines_avx2(
+                std::string_view buffer, std::size_t line_start,
+                std::size_t begin, std::size_t end, std::vector<Line> &lines
+        ) {
+            constexpr std::size_t block_size{32};
+
+            auto const data{buffer.data()};
+            auto const needle{_mm256_set1_epi8('\n')};
+            auto       pos{begin};
+
+            for (; pos + block_size <= end; pos += block_size) {
+                auto const block{_mm256_loadu_si256(
+                        reinterpret_cast<__m256i const *>(data + pos)
+                )};
+                auto mask{static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle))
+                )};
+
+                while (mask != 0) {
+                    emit_line(lines, line_start, pos + std::countr_zero(mask));
+                    mask &= mask - 1;
+                }
+            }
+
+            for (; pos < end; ++pos) {
+                if (data[pos] == '\n')
+                    emit_line(lines, line_start, pos);
+            }
+
+            return line_start;
+        }
+#endif
+
+        Kernels get_kernels(LineKernel kernel) noexcept {
+            switch (kernel) {
+#ifdef MJOLNIR_SCAN_X86
+                case LineKernel::Avx2:
+                    return {count_newlines_avx2, scan_lines_avx2};
+                case LineKernel::Sse2:
+                    return {count_newlines_sse2, scan_lines_sse2};
+#endif
+                default:
+                    return {count_newlines_scalar, scan_lines_scalar};
+            }
+        }
+
+        Kernels select_kernels() {
+            for (auto const kernel : {LineKernel::Avx2, LineKernel::Sse2}) {
+                if (is_supported(kernel))
+                    return get_kernels(kernel);
+            }
+
+            return get_kernels(LineKernel::Memchr);
+        }
+
+        std::size_t scan_lines_with(
+                Kernels const &kernels, std::string_view buffer,
+                std::size_t line_start, std::size_t begin, std::size_t end,
+                std::vector<Line> &lines
+        ) {
+            // Counting first is a fraction of the cost of growing the vector
+            // several times over on large buffers. Growth stays geometric so
+            // that scanning in many small chunks doesn't reallocate every
+            // time.
+            auto const needed{
+                    lines.size() +
+                    kernels.count_(buffer.data() + begin, end - begin)
+            };
+            if (needed > lines.capacity())
+                lines.reserve(std::max(needed, lines.capacity() * 2));
+
+            return kernels.scan_(buffer, line_start, begin, end, lines);
+        }
+    }// namespace
+
+    bool is_supported(LineKernel kernel) noexcept {
+        switch (kernel) {
+#ifdef MJOLNIR_SCAN_X86
+            case LineKernel::Avx2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") &&
+                       __builtin_cpu_supports("popcnt");
+            case LineKernel::Sse2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("sse2");
+#endif
+            case LineKernel::Memchr:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::size_t scan_lines(
+            std::string_view buffer, std::size_t line_start, std::size_t begin,
+            std::size_t end, std::vector<Line> &lines
+    ) {
+        static Kernels const kernels{select_kernels()};
+
+        return scan_lines_with(kernels, buffer, line_start, begin, end, lines);
+    }
+
+    std::size_t scan_lines(
+            LineKernel kernel, std::string_view buffer, std::size_t line_start,
+            std::size_t begin, std::size_t end, std::vector<Line> &lines
+    ) {
+        return scan_lines_with(
+                get_kernels(kernel), buffer, line_start, begin, end, lines
+        );
+    }
+}// namespace mjolnir::internal
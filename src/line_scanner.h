@@ -0,0 +1,38 @@
+#ifndef LINE_SCANNER_H
+#define LINE_SCANNER_H
+
+#include <cstddef>    // for size_t
+#include <string_view>// for string_view
+#include <vector>     // for vector
+
+#include "mjolnir/source.hpp"// for Line
+
+namespace mjolnir::internal {
+    // Scans buffer[begin, end) for '\n' and appends a Line for every line
+    // terminated inside that range, numbered after the lines already present.
+    // `line_start` is where the line that is open at `begin` starts. Returns
+    // the offset at which the still unterminated line starts.
+    //
+    // Picks the widest newline search the CPU supports (AVX2, SSE2) on first
+    // use, and falls back to memchr elsewhere.
+    std::size_t scan_lines(
+            std::string_view buffer, std::size_t line_start, std::size_t begin,
+            std::size_t end, std::vector<Line> &lines
+    );
+
+    // The newline searches scan_lines picks from.
+    enum class LineKernel { Memchr, Sse2, Avx2 };
+
+    // Whether this build and CPU can run `kernel`; Memchr always can.
+    [[nodiscard]]
+    bool is_supported(LineKernel kernel) noexcept;
+
+    // scan_lines, but with the given kernel rather than the widest one, so
+    // that tests and benchmarks can compare them. `kernel` must be supported.
+    std::size_t scan_lines(
+            LineKernel kernel, std::string_view buffer, std::size_t line_start,
+            std::size_t begin, std::size_t end, std::vector<Line> &lines
+    );
+}// namespace mjolnir::internal
+
+#endif//LINE_SCANNER_H
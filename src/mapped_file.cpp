@@ -0,0 +1,152 @@
+#include "mapped_file.h"
+
+#include <filesystem>  // for path
+#include <memory>      // for shared_ptr, make_shared
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <system_error>// for system_error, error_code, system_category
+#include <utility>     // for move
+
+#if __has_include(<sys/mman.h>)
+#define MJOLNIR_HAS_MMAP
+#include <cerrno>     // for errno, EINTR
+#include <fcntl.h>    // for open, O_RDONLY, O_CLOEXEC
+#include <sys/mman.h> // for mmap, munmap, madvise, MAP_FAILED
+#include <sys/stat.h> // for fstat, stat, S_ISREG
+#include <unistd.h>   // for close, read
+#else
+#include <fstream> // for ifstream
+#include <iterator>// for istreambuf_iterator
+#endif
+
+namespace mjolnir::internal {
+    namespace {
+#ifdef MJOLNIR_HAS_MMAP
+        [[noreturn]]
+        void throw_errno(std::filesystem::path const &path) {
+            throw std::system_error{
+                    std::error_code{errno, std::system_category()},
+                    path.string()
+            };
+        }
+
+        class FileDescriptor final {
+            int fd_;
+
+        public:
+            explicit FileDescriptor(int fd) noexcept
+                : fd_{fd} {
+            }
+
+            FileDescriptor(FileDescriptor const &) = delete;
+
+            FileDescriptor &operator=(FileDescriptor const &) = delete;
+
+            ~FileDescriptor() {
+                ::close(fd_);
+            }
+
+            [[nodiscard]]
+            int get() const noexcept {
+                return fd_;
+            }
+        };
+
+        // Reads the file front to back, for files that can't be mapped.
+        MappedFile
+        read_file(FileDescriptor const &fd, std::filesystem::path const &path) {
+            std::string contents(4096, '\0');
+            std::size_t size{0};
+            while (true) {
+                if (size == contents.size())
+                    contents.resize(size * 2);
+
+                auto const count{::read(
+                        fd.get(), contents.data() + size, contents.size() - size
+                )};
+                if (count == 0)
+                    break;
+
+                if (count < 0) {
+                    if (errno == EINTR)
+                        continue;
+
+                    throw_errno(path);
+                }
+
+                size += static_cast<std::size_t>(count);
+            }
+            contents.resize(size);
+
+            auto const storage{
+                    std::make_shared<std::string const>(std::move(contents))
+            };
+            return {.storage_ = storage, .contents_ = *storage};
+        }
+#else
+        // Reads the file front to back, for files that can't be mapped.
+        MappedFile read_file(std::filesystem::path const &path) {
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+                throw std::system_error{
+                        std::make_error_code(
+                                std::errc::no_such_file_or_directory
+                        ),
+                        path.string()
+                };
+
+            auto const contents{std::make_shared<std::string const>(
+                    std::istreambuf_iterator<char>{file},
+                    std::istreambuf_iterator<char>{}
+            )};
+
+            return {.storage_ = contents, .contents_ = *contents};
+        }
+#endif
+    }// namespace
+
+#ifdef MJOLNIR_HAS_MMAP
+    MappedFile map_file(std::filesystem::path const &path) {
+        auto const raw_fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (raw_fd < 0)
+            throw_errno(path);
+
+        FileDescriptor const fd{raw_fd};
+
+        struct stat info{};
+        if (::fstat(fd.get(), &info) != 0)
+            throw_errno(path);
+
+        // Only a regular file's size says how much there is to map. Pipes
+        // and devices have none, and files such as those in /proc claim to
+        // be empty; mmap refuses empty mappings anyway. Those are read
+        // instead, from the descriptor already open, so that a pipe is
+        // read by the reader it already has.
+        if (!S_ISREG(info.st_mode) || info.st_size == 0)
+            return read_file(fd, path);
+
+        auto const size{static_cast<std::size_t>(info.st_size)};
+        auto const address{
+                ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0)
+        };
+        if (address == MAP_FAILED)
+            throw_errno(path);
+
+        // Only a hint, so a failure here is not worth reporting.
+        ::madvise(address, size, MADV_SEQUENTIAL);
+
+        std::shared_ptr<void const> storage{
+                address, [size](void const *mapped) {
+                    ::munmap(const_cast<void *>(mapped), size);
+                }
+        };
+
+        return {.storage_  = std::move(storage),
+                .contents_ = {static_cast<char const *>(address), size}};
+    }
+#else
+    MappedFile map_file(std::filesystem::path const &path) {
+        return read_file(path);
+    }
+#endif
+}// namespace mjolnir::internal
@@ -0,0 +1,23 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <filesystem> // for path
+#include <memory>     // for shared_ptr
+#include <string_view>// for string_view
+
+namespace mjolnir::internal {
+    struct MappedFile final {
+        // Keeps the mapping (or, where the file can't be mapped, the buffer
+        // it was read into) alive for as long as anyone holds on to it.
+        std::shared_ptr<void const> storage_;
+        std::string_view            contents_;
+    };
+
+    // Maps the file at `path` read-only into memory, hinting to the kernel
+    // that it is going to be read front to back. Anything but a non-empty
+    // regular file, such as a pipe or a file in /proc, is read instead.
+    [[nodiscard]]
+    MappedFile map_file(std::filesystem::path const &path);
+}// namespace mjolnir::internal
+
+#endif//MAPPED_FILE_H
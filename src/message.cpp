@@ -0,0 +1,105 @@
+#include "mjolnir/message.hpp"// for Message
+
+#include <cstddef>    // for size_t
+#include <format>     // for vformat_to, format_args
+#include <functional> // for hash
+#include <iterator>   // for back_inserter
+#include <mutex>      // for call_once
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <utility>    // for move
+
+#include "mjolnir/sink.hpp"// for Sink, operator<<
+
+namespace mjolnir {
+    void Message::format_into(
+            std::pmr::string &text, std::string_view format,
+            std::format_args args
+    ) {
+        std::vformat_to(std::back_inserter(text), format, args);
+    }
+
+    std::string_view Message::Formatter::get_text() const {
+        std::call_once(formatted_, [this] { format(text_); });
+        return text_;
+    }
+
+    Message::Message(std::string_view text, allocator_type allocator)
+        : text_{text, allocator} {
+    }
+
+    Message::Message(Message const &other)
+        : Message{other, allocator_type{}} {
+    }
+
+    Message::Message(Message const &other, allocator_type allocator)
+        : text_{allocator} {
+        assign(other);
+    }
+
+    Message::Message(Message &&other, allocator_type allocator)
+        : text_{allocator} {
+        *this = std::move(other);
+    }
+
+    Message &Message::operator=(Message const &other) {
+        if (this != &other)
+            assign(other);
+
+        return *this;
+    }
+
+    Message &Message::operator=(Message &&other) {
+        if (get_allocator() != other.get_allocator()) {
+            assign(other);
+            return *this;
+        }
+
+        text_      = std::move(other.text_);
+        formatter_ = std::move(other.formatter_);
+        return *this;
+    }
+
+    void Message::assign(Message const &other) {
+        // The formatter, and the text it keeps, live in the resource of the
+        // message that bound it; text_ always shares that resource.
+        if (other.formatter_ != nullptr &&
+            get_allocator() == other.get_allocator()) {
+            text_.clear();
+            formatter_ = other.formatter_;
+            return;
+        }
+
+        text_ = other.get_text();
+        formatter_.reset();
+    }
+
+    Message::allocator_type Message::get_allocator() const noexcept {
+        return text_.get_allocator();
+    }
+
+    void Message::write(Sink &sink) const {
+        sink << get_text();
+    }
+
+    std::string_view Message::get_text() const {
+        if (formatter_ != nullptr)
+            return formatter_->get_text();
+
+        return text_;
+    }
+
+    std::string Message::to_string() const {
+        return std::string{get_text()};
+    }
+
+    bool Message::operator==(Message const &other) const {
+        return get_text() == other.get_text();
+    }
+}// namespace mjolnir
+
+std::size_t std::hash<mjolnir::Message>::operator()(
+        mjolnir::Message const &message
+) const {
+    return std::hash<std::string_view>{}(message.get_text());
+}
@@ -1,19 +1,21 @@
 #include "mjolnir/report.hpp"// for Report, BasicReportKind, CustomReportKind
 
-#include <cstddef>    // for size_t
-#include <iosfwd>     // for ostream
-#include <optional>   // for optional
-#include <set>        // for set
-#include <stdexcept>  // for logic_error, out_of_range
-#include <string>     // for string, char_traits
-#include <string_view>// for string_view
-#include <utility>    // for move
-#include <variant>    // for get, holds_alternative
-#include <vector>     // for vector
+#include <cstddef>        // for size_t
+#include <iosfwd>         // for ostream
+#include <memory_resource>// for polymorphic_allocator
+#include <optional>       // for optional, nullopt
+#include <span>           // for span
+#include <stdexcept>      // for logic_error, out_of_range
+#include <string>         // for string, char_traits
+#include <string_view>    // for string_view
+#include <utility>        // for move
+#include <variant>        // for get, holds_alternative
+#include <vector>         // for vector
 
 #include "mjolnir/color.hpp" // for Color, light_cyan, light_red, light_ye...
 #include "mjolnir/draw.hpp"  // for Characters
-#include "mjolnir/source.hpp"// for Label, Line, Source
+#include "mjolnir/sink.hpp"  // for OstreamSink, Sink
+#include "mjolnir/source.hpp"// for Label, Source
 #include "mjolnir/span.hpp"  // for Span
 #include "report_printer.h"  // for ReportPrinter
 
@@ -57,49 +59,73 @@ namespace mjolnir {
         }
     }// namespace report_kind
 
-    std::set<Line> Report::get_lines() const {
-        std::set<Line> lines{};
-        for (auto const &label : labels_) {
-            if (auto const startLine{
-                        source_->get_line_info(label.get_span().start())
-                };
-                startLine.has_value())
-                lines.emplace(startLine.value());
-
-            if (auto const endLine{source_->get_line_info(label.get_span().end()
-                )};
-                endLine.has_value())
-                lines.emplace(endLine.value());
-        }
-
-        return lines;
-    }
-
-    Report::Report(ReportKind kind, Source const &source, std::size_t start_pos)
+    Report::Report(
+            ReportKind kind, Source const &source, std::size_t start_pos,
+            allocator_type allocator
+    )
         : kind_{std::move(kind)}
         , start_pos_{start_pos}
-        , source_{&source} {
+        , source_{&source}
+        , notes_{allocator}
+        , help_{allocator}
+        , labels_{allocator} {
         if (start_pos >= source.size())
             throw std::out_of_range{"start_pos is out of range"};
     }
 
-    Report &Report::with_code(std::string code) {
-        code_ = std::move(code);
+    Report::allocator_type Report::get_allocator() const noexcept {
+        return labels_.get_allocator();
+    }
+
+    ReportKind const &Report::get_kind() const noexcept {
+        return kind_;
+    }
+
+    std::optional<std::string_view> Report::get_code() const noexcept {
+        if (!code_.has_value())
+            return std::nullopt;
+
+        return *code_;
+    }
+
+    std::optional<Message> const &Report::get_message() const noexcept {
+        return message_;
+    }
+
+    std::span<Label const> Report::get_labels() const noexcept {
+        return labels_;
+    }
+
+    Source const &Report::get_source() const noexcept {
+        return *source_;
+    }
+
+    std::size_t Report::get_start_pos() const noexcept {
+        return start_pos_;
+    }
+
+    Report &Report::with_kind(ReportKind kind) {
+        kind_ = std::move(kind);
         return *this;
     }
 
-    Report &Report::with_message(std::string message) {
-        message_ = std::move(message);
+    Report &Report::with_code(std::string_view code) {
+        code_.emplace(code, get_allocator());
         return *this;
     }
 
-    Report &Report::with_note(std::string note) {
-        notes_.emplace_back(std::move(note));
+    Report &Report::with_message(std::string_view message) {
+        message_.emplace(message, get_allocator());
         return *this;
     }
 
-    Report &Report::with_help(std::string help) {
-        help_.emplace_back(std::move(help));
+    Report &Report::with_note(std::string_view note) {
+        notes_.emplace_back(note);
+        return *this;
+    }
+
+    Report &Report::with_help(std::string_view help) {
+        help_.emplace_back(help);
         return *this;
     }
 
@@ -116,9 +142,12 @@ namespace mjolnir {
     }
 
     void Report::print(std::ostream &os) const {
-        auto const characters{config_.characters};
+        OstreamSink sink{os};
+        render_to(sink);
+    }
 
-        ReportPrinter const printer{os, *this};
+    void Report::render_to(Sink &sink) const {
+        ReportPrinter const printer{sink, *this};
         printer.print_header();
         printer.print_empty_line();
         printer.print_lines();
@@ -1,150 +1,700 @@
 #include "report_printer.h"
 
-#include <format>     // for format
-#include <iterator>   // for next
-#include <optional>   // for optional
-#include <string_view>// for operator<<
-#include <variant>    // for get, holds_alternative
-#include <vector>     // for vector
-
-#include "mjolnir/color.hpp" // for Color, gray, light_blue, light_cyan
-#include "mjolnir/draw.hpp"  // for Characters
-#include "mjolnir/report.hpp"// for Report, to_color, to_string, BasicRepo...
-#include "mjolnir/span.hpp"  // for ColoredSpan, Span
+#include <algorithm>      // for find_if, sort, unique, any_of, count_if, max
+#include <memory>         // for make_shared
+#include <memory_resource>// for polymorphic_allocator
+#include <span>           // for span
+#include <optional>       // for optional
+#include <string>         // for string
+#include <string_view>    // for string_view, operator<<
+#include <utility>        // for pair, move
+#include <variant>        // for get, holds_alternative
+#include <vector>         // for vector
+
+#include "mjolnir/color.hpp"        // for Color, gray, light_blue, light_cyan
+#include "mjolnir/draw.hpp"         // for Characters
+#include "mjolnir/report.hpp"       // for Report, to_color, to_string, Basi...
+#include "mjolnir/sink.hpp"         // for Sink, StringSink, PmrStringSink, o...
+#include "mjolnir/snippet_cache.hpp"// for SnippetCache
+#include "mjolnir/span.hpp"         // for ColoredSpan, Span
 
 namespace mjolnir {
-    Characters const &ReportPrinter::get_characters() const noexcept {
-        return report_->config_.characters;
+    namespace {
+        template<typename T>
+        void append_bytes(std::string &key, T const &value) {
+            key.append(reinterpret_cast<char const *>(&value), sizeof value);
+        }
+
+        void append_text(std::string &key, std::string_view text) {
+            append_bytes(key, text.size());
+            key.append(text);
+        }
+
+        // Only the first byte of a UTF-8 character isn't one of these.
+        bool is_continuation_byte(char byte) noexcept {
+            return (static_cast<unsigned char>(byte) & 0xC0) == 0x80;
+        }
+    }// namespace
+
+    std::pmr::vector<ReportPrinter::LabelLines>
+    ReportPrinter::resolve_label_lines() const {
+        auto const &labels{report_->labels_};
+
+        std::pmr::vector<std::size_t> offsets{report_->get_allocator()};
+        offsets.reserve(labels.size() * 2);
+        for (auto const &label : labels) {
+            offsets.emplace_back(label.get_span().start());
+            offsets.emplace_back(label.get_span().end());
+        }
+
+        auto const lines{
+                report_->source_->resolve(offsets, report_->get_allocator())
+        };
+
+        // A span may end where the source does, past its last line; it ends
+        // on that line then.
+        auto const &source{*report_->source_};
+        auto const  last_line{
+                source.size() > 0 ? source.get_line_info(source.size() - 1)
+                                  : std::nullopt
+        };
+
+        std::pmr::vector<LabelLines> label_lines{report_->get_allocator()};
+        label_lines.reserve(labels.size());
+        for (std::size_t i{0}; i < labels.size(); ++i) {
+            label_lines.emplace_back(LabelLines{
+                    .start_ = lines[i * 2],
+                    .end_   = lines[i * 2 + 1].has_value() ? lines[i * 2 + 1]
+                                                           : last_line
+            });
+        }
+
+        return label_lines;
     }
 
-    std::set<internal::SpannedLine> ReportPrinter::get_spanned_lines() const {
-        std::set<internal::SpannedLine> spanned_lines{};
+    std::pmr::vector<ReportPrinter::MultilineLabel>
+    ReportPrinter::get_multiline_labels() const {
+        auto const &labels{report_->labels_};
+
+        std::pmr::vector<MultilineLabel> multiline_labels{
+                report_->get_allocator()
+        };
+        for (std::size_t i{0}; i < labels.size(); ++i) {
+            auto const start_line{label_lines_[i].start_.value().line_number_};
+            auto const end_line{label_lines_[i].end_.value().line_number_};
+
+            if (start_line != end_line) {
+                multiline_labels.emplace_back(MultilineLabel{
+                        .label_      = &labels[i],
+                        .start_line_ = start_line,
+                        .end_line_   = end_line,
+                        .lane_       = multiline_labels.size()
+                });
+            }
+        }
+
+        // Outer labels go left of the ones they enclose. Ties are broken by
+        // the order the labels were added in, which lane_ still holds.
+        std::ranges::sort(
+                multiline_labels,
+                [](MultilineLabel const &lhs, MultilineLabel const &rhs) {
+                    if (lhs.start_line_ != rhs.start_line_)
+                        return lhs.start_line_ < rhs.start_line_;
 
-        auto const get_spanned_line{[&](Label const &label, Line const &line) {
-            auto const span{label.get_span()};
-            auto [it, _]{spanned_lines.emplace(internal::SpannedLine{line, {}})
-            };
+                    if (lhs.end_line_ != rhs.end_line_)
+                        return lhs.end_line_ > rhs.end_line_;
 
-            auto extracted{spanned_lines.extract(it)};
+                    return lhs.lane_ < rhs.lane_;
+                }
+        );
 
-            auto &spans{extracted.value().spans_};
+        std::pmr::vector<std::size_t> lane_ends{report_->get_allocator()};
+        for (auto &multiline : multiline_labels) {
+            // a lane is free once its label's message has been printed
+            auto const free{std::ranges::find_if(lane_ends, [&](auto end) {
+                return end < multiline.start_line_;
+            })};
+
+            multiline.lane_ = free - lane_ends.begin();
+            if (free == lane_ends.end())
+                lane_ends.emplace_back(multiline.end_line_);
+            else
+                *free = multiline.end_line_;
+        }
 
-            internal::ColoredSpan label_span{line.get_subspan(span), &label};
-            spans.emplace(label_span);
+        return multiline_labels;
+    }
 
-            spanned_lines.insert(std::move(extracted));
-        }};
-        for (auto const &label : report_->labels_) {
-            auto const span{label.get_span()};
-            auto const start_line{
-                    report_->source_->get_line_info(span.start()).value()
-            };
-            auto const end_line{
-                    report_->source_->get_line_info(span.end()).value()
+    std::size_t
+    ReportPrinter::get_last_shown_line_nr(std::size_t last_labelled) const {
+        auto const context{report_->config_.context_lines};
+        if (context == 0)
+            return last_labelled;
+
+        auto const &source{*report_->source_};
+        auto const  last_line{source.get_line_info(source.size() - 1)};
+
+        return std::min(last_labelled + context, last_line->line_number_);
+    }
+
+    std::size_t ReportPrinter::digit_count(std::size_t number) noexcept {
+        std::size_t digits{1};
+        for (; number >= 10; number /= 10) ++digits;
+
+        return digits;
+    }
+
+    Characters const &ReportPrinter::get_characters() const noexcept {
+        return report_->config_.characters.get();
+    }
+
+    ReportPrinter::Layout ReportPrinter::get_spanned_lines() const {
+        struct Record final {
+            Line                  line_;
+            internal::ColoredSpan colored_span_;
+            std::size_t           order_;
+        };
+
+        auto const &labels{report_->labels_};
+
+        auto const allocator{report_->get_allocator()};
+
+        std::pmr::vector<Record> records{allocator};
+        records.reserve(labels.size() * 2);
+        for (std::size_t i{0}; i < labels.size(); ++i) {
+            auto const &label{labels[i]};
+            auto const  span{label.get_span()};
+
+            auto const &[start_line, end_line]{label_lines_[i]};
+            bool const multiline{
+                    start_line->line_number_ != end_line->line_number_
             };
-            get_spanned_line(label, start_line);
-            get_spanned_line(label, end_line);
+
+            // Clipped to the line, so the span can't be multi-line by itself
+            // and never has to be checked for that when highlighting.
+            for (auto const &line : {start_line.value(), end_line.value()}) {
+                records.emplace_back(Record{
+                        line,
+                        {line.get_subspan(span), &label, multiline},
+                        records.size()
+                });
+            }
         }
 
-        // add the uncolored lines
-        for (auto &line : spanned_lines) {
-            auto  spans_copy{line.spans_};
-            auto  extracted{spanned_lines.extract(line)};
-            auto &spans{extracted.value().spans_};
-            auto  span_start{line.line_.byte_offset_};
-            auto  last_start{span_start};
+        // Context lines are walked to one at a time from the labelled lines,
+        // so however long a multi-line label is, only the lines actually
+        // shown are looked at. They are recorded without a label, only to
+        // have the line show up.
+        if (auto const context{report_->config_.context_lines}; context > 0) {
+            auto const &source{*report_->source_};
+            auto const  labelled{records.size()};
+            records.reserve(labelled * (1 + 2 * context));
+
+            auto const add_context_line{[&](Line const &line) {
+                records.emplace_back(Record{
+                        line,
+                        {{line.byte_offset_, line.byte_offset_}, nullptr},
+                        records.size()
+                });
+            }};
+
+            for (std::size_t i{0}; i < labelled; ++i) {
+                auto before{records[i].line_};
+                auto after{records[i].line_};
+
+                for (std::size_t n{0}; n < context; ++n) {
+                    if (before.byte_offset_ > 0) {
+                        before = source.get_line_info(before.byte_offset_ - 1)
+                                         .value();
+                        add_context_line(before);
+                    }
+
+                    if (auto const next{source.get_line_info(after.end() + 1)}
+                    ) {
+                        after = *next;
+                        add_context_line(after);
+                    }
+                }
+            }
+        }
+
+        // Of several segments starting at the same spot on a line, the one
+        // added first wins. Ties are broken by the order they were added in
+        // rather than with a stable sort, which would need a buffer of its
+        // own from outside the report's allocator.
+        auto const record_key{[](Record const &record) {
+            return std::pair{
+                    record.line_.byte_offset_,
+                    record.colored_span_.span_.start()
+            };
+        }};
+        std::ranges::sort(records, {}, [&](Record const &record) {
+            return std::pair{record_key(record), record.order_};
+        });
+        auto const duplicates{std::ranges::unique(records, {}, record_key)};
+        records.erase(duplicates.begin(), duplicates.end());
+
+        // a line's gaps number at most one more than its labelled segments
+        Layout layout{
+                .spans_ = std::pmr::vector<internal::ColoredSpan>{allocator},
+                .lines_ = std::pmr::vector<internal::SpannedLine>{allocator}
+        };
+        layout.spans_.reserve(records.size() * 3);
+
+        struct LineEntry final {
+            Line        line_;
+            std::size_t first_;
+        };
+
+        std::pmr::vector<LineEntry> line_entries{allocator};
+
+        struct Segment final {
+            internal::ColoredSpan colored_span_;
+            std::size_t           order_;
+        };
+
+        std::pmr::vector<Segment> segments{allocator};
+        for (auto group{records.cbegin()}; group != records.cend();) {
+            auto const &line{group->line_};
+            auto const  group_end{std::find_if(
+                    group, records.cend(),
+                    [&](Record const &record) {
+                        return record.line_.byte_offset_ != line.byte_offset_;
+                    }
+            )};
+
+            // Overlapping labels are cut to start where the one before them
+            // ends, so that the segments of a line never overlap and each
+            // starts past the one before it. A label the ones before it
+            // cover entirely has nothing left to show on this line.
+            segments.clear();
+            auto covered{line.byte_offset_};
+            for (auto it{group}; it != group_end; ++it) {
+                if (it->colored_span_.label_ptr_ == nullptr)
+                    continue;// only there to show a context line
+
+                auto       colored_span{it->colored_span_};
+                auto const span{colored_span.span_};
+                if (span.end() <= covered)
+                    continue;
+
+                colored_span.span_ = {
+                        std::max(span.start(), covered), span.end()
+                };
+                covered = span.end();
+                segments.emplace_back(Segment{colored_span, segments.size()});
+            }
+
+            // add the uncolored lines
+            auto const label_segments{segments.size()};
+            auto       span_start{line.byte_offset_};
+            auto       last_start{span_start};
+
+            for (std::size_t i{0}; i < label_segments; ++i) {
+                auto const label_span{segments[i].colored_span_.span_};
 
-            for (auto it{spans_copy.cbegin()}; it != spans_copy.cend(); ++it) {
                 internal::ColoredSpan const after_span{
                         {last_start, span_start}, nullptr
                 };
                 if (!after_span.span_.empty())
-                    spans.emplace(after_span);
+                    segments.emplace_back(Segment{after_span, segments.size()});
 
                 internal::ColoredSpan const before_span{
-                        {span_start, it->span_.start()}, nullptr
+                        {span_start, label_span.start()}, nullptr
                 };
 
                 if (!before_span.span_.empty()) {
-                    spans.emplace(before_span);
+                    segments.emplace_back(
+                            Segment{before_span, segments.size()}
+                    );
                 }
 
                 last_start = span_start;
-                span_start = it->span_.end();
+                span_start = label_span.end();
             }
 
             internal::ColoredSpan const after_span{
-                    {span_start, line.line_.end()}, nullptr
+                    {span_start, line.end()}, nullptr
             };
             if (!after_span.span_.empty())
-                spans.emplace(after_span);
+                segments.emplace_back(Segment{after_span, segments.size()});
+
+            // Gaps never replace a segment that already starts at the same
+            // spot, same as above.
+            auto const segment_start{[](Segment const &segment) {
+                return segment.colored_span_.span_.start();
+            }};
+            std::ranges::sort(segments, {}, [&](Segment const &segment) {
+                return std::pair{segment_start(segment), segment.order_};
+            });
+            auto const overlapping{
+                    std::ranges::unique(segments, {}, segment_start)
+            };
+            segments.erase(overlapping.begin(), overlapping.end());
+
+            line_entries.emplace_back(LineEntry{line, layout.spans_.size()});
+            for (auto const &segment : segments) {
+                layout.spans_.emplace_back(segment.colored_span_);
+            }
+
+            group = group_end;
+        }
+
+        // Only now that spans_ is done growing can the lines point into it.
+        layout.lines_.reserve(line_entries.size());
+        for (std::size_t i{0}; i < line_entries.size(); ++i) {
+            auto const last{
+                    i + 1 < line_entries.size() ? line_entries[i + 1].first_
+                                                : layout.spans_.size()
+            };
+            layout.lines_.emplace_back(internal::SpannedLine{
+                    line_entries[i].line_,
+                    std::span{layout.spans_}.subspan(
+                            line_entries[i].first_, last - line_entries[i].first_
+                    )
+            });
+        }
+
+        return layout;
+    }
+
+    ReportPrinter::Window ReportPrinter::get_window(
+            internal::SpannedLine const             &spanned_line,
+            std::pmr::vector<internal::ColoredSpan> &spans,
+            std::pmr::vector<Piece>                 &pieces
+    ) const {
+        auto const &[line, colored_spans]{spanned_line};
+
+        auto const max_width{report_->config_.max_line_width};
+        if (!max_width.has_value() || line.byte_length_ <= *max_width)
+            return Window{spanned_line, {}};
+
+        // room for a character between the markers on either end
+        auto const width{std::max<std::size_t>(*max_width, 3) - 2};
+
+        // Cuts are only ever made between two characters.
+        auto const content{report_->source_->get_line(line)};
+        auto const char_start{[&](std::size_t offset) {
+            while (offset > line.byte_offset_ && offset < line.end() &&
+                   is_continuation_byte(content[offset - line.byte_offset_])) {
+                --offset;
+            }
+
+            return offset;
+        }};
+
+        auto labelled_start{line.end()};
+        auto labelled_end{line.byte_offset_};
+        for (auto const &[span, label_ptr, multiline] : colored_spans) {
+            if (label_ptr == nullptr)
+                continue;
+
+            labelled_start = std::min(labelled_start, span.start());
+            labelled_end   = std::max(labelled_end, span.end());
+        }
+        if (labelled_start > labelled_end)// a context line
+            labelled_start = labelled_end = line.byte_offset_;
+
+        // The labelled columns are centered. If they don't fit, all of them
+        // are shown nonetheless, with the middle of the widest segments cut.
+        auto start{labelled_start};
+        auto end{labelled_end};
+        if (end - start < width) {
+            auto const slack{width - (end - start)};
+            start -= std::min(slack / 2, start - line.byte_offset_);
+            start = std::min(start, line.end() - width);
+            end   = start + width;
+        }
+        start = char_start(start);
+        end   = char_start(end);
+
+        auto const is_shown{[&](Span const &span) {
+            if (span.empty())
+                return start <= span.start() && span.start() <= end;
 
-            spanned_lines.insert(std::move(extracted));
+            return span.start() < end && span.end() > start;
+        }};
+
+        // Segments only get cut when the labelled columns alone don't fit,
+        // each of them then getting an equal share of the width.
+        auto const shown{std::ranges::count_if(
+                colored_spans,
+                [&](internal::ColoredSpan const &colored_span) {
+                    return is_shown(colored_span.span_);
+                }
+        )};
+        auto const share{
+                end - start > width
+                        ? std::max<std::size_t>(
+                                  width / static_cast<std::size_t>(shown), 3
+                          )
+                        : end - start
+        };
+
+        spans.clear();
+        pieces.clear();
+
+        std::size_t column{0};
+        auto const  add_piece{[&](Piece const &piece,
+                                  Label const *label_ptr = nullptr,
+                                  bool         multiline = false) {
+            auto const size{
+                    piece.head_.size() + piece.cut_ + piece.tail_.size()
+            };
+            spans.emplace_back(internal::ColoredSpan{
+                    {column, column + size}, label_ptr, multiline
+            });
+            pieces.emplace_back(piece);
+            column += size;
+        }};
+
+        if (start > line.byte_offset_)
+            add_piece(Piece{{start, start}, true, {start, start}});
+
+        for (auto const &[span, label_ptr, multiline] : colored_spans) {
+            if (!is_shown(span))
+                continue;
+
+            Span const cut{
+                    std::max(span.start(), start), std::min(span.end(), end)
+            };
+            if (cut.size() <= share) {
+                add_piece(
+                        Piece{cut, false, {cut.end(), cut.end()}}, label_ptr,
+                        multiline
+                );
+                continue;
+            }
+
+            Span const head{
+                    cut.start(), char_start(cut.start() + (share - 1) / 2)
+            };
+            Span const tail{char_start(cut.end() - share / 2), cut.end()};
+            add_piece(Piece{head, true, tail}, label_ptr, multiline);
         }
 
-        return spanned_lines;
+        if (end < line.end())
+            add_piece(Piece{{end, end}, true, {end, end}});
+
+        return Window{
+                internal::SpannedLine{
+                        Line{0, column, line.line_number_}, spans
+                },
+                pieces
+        };
+    }
+
+    ColorMode ReportPrinter::get_color_mode() const noexcept {
+        return report_->config_.color_mode;
+    }
+
+    void ReportPrinter::start_color(Color const &color) const {
+        start_color(*sink_, color);
+    }
+
+    void ReportPrinter::start_color(Sink &sink, Color const &color) const {
+        if (get_color_mode() == ColorMode::None)
+            return;
+
+        sink << color.fg_start(get_color_mode());
+    }
+
+    void ReportPrinter::end_color() const {
+        end_color(*sink_);
+    }
+
+    void ReportPrinter::end_color(Sink &sink) const {
+        if (get_color_mode() == ColorMode::None)
+            return;
+
+        sink << Color::end;
     }
 
     void ReportPrinter::print_line_start(std::size_t line_nr) const {
         auto const &characters{get_characters()};
 
-        *os_ << std::string(line_number_padding_before, ' ')
-             << std::format("{: >{}}", line_nr, max_line_nr_len_)
-             << std::string(line_number_padding_after, ' ')
-             << characters.vertical_bar_ << padding_after_vert_bar_str_;
+        sink_->fill(
+                ' ', line_number_padding_before + max_line_nr_len_ -
+                             digit_count(line_nr)
+        );
+        *sink_ << line_nr;
+        sink_->fill(' ', line_number_padding_after);
+        *sink_ << characters.vertical_bar_ << padding_after_vert_bar_str_;
     }
 
     void ReportPrinter::print_non_code_line_start() const {
         auto const &characters{get_characters()};
 
-        *os_ << line_number_space_
-             << colors::gray.fg(characters.vertical_interruption_)
-             << padding_after_vert_bar_str_;
+        *sink_ << line_number_space_;
+        start_color(colors::gray);
+        *sink_ << characters.vertical_interruption_;
+        end_color();
+        *sink_ << padding_after_vert_bar_str_;
+    }
+
+    void ReportPrinter::print_gutter(
+            std::size_t line_nr, GutterRow row, std::size_t closing_lane
+    ) const {
+        if (lane_count_ == 0)
+            return;
+
+        auto const &characters{get_characters()};
+
+        // the label occupying each lane on this row, if any
+        std::pmr::vector<MultilineLabel const *> lanes(
+                lane_count_, nullptr, report_->get_allocator()
+        );
+        for (auto const &multiline : multiline_labels_) {
+            auto const occupies{[&] {
+                switch (row) {
+                    case GutterRow::Elision:
+                        return multiline.start_line_ <= line_nr &&
+                               line_nr < multiline.end_line_;
+                    case GutterRow::Closing:
+                        // those right of the closing lane closed before it
+                        if (multiline.lane_ > closing_lane &&
+                            multiline.end_line_ == line_nr)
+                            return false;
+                        [[fallthrough]];
+                    default:
+                        return multiline.start_line_ <= line_nr &&
+                               line_nr <= multiline.end_line_;
+                }
+            }()};
+
+            if (occupies)
+                lanes[multiline.lane_] = &multiline;
+        }
+
+        // Once a label's arrow (or its closing bar) starts, it runs right
+        // through every lane after it.
+        std::optional<Color> bar_color{};
+        bool                 bar{false};
+
+        auto const print_colored{
+                [&](std::string_view glyph, std::optional<Color> const &color) {
+                    if (color.has_value())
+                        start_color(*color);
+
+                    *sink_ << glyph;
+
+                    if (color.has_value())
+                        end_color();
+                }
+        };
+
+        for (std::size_t lane{0}; lane < lane_count_; ++lane) {
+            auto const *multiline{lanes[lane]};
+
+            if (multiline == nullptr) {
+                if (bar)
+                    print_colored(characters.horizontal_bar_, bar_color);
+                else
+                    *sink_ << ' ';
+            } else {
+                auto const &color{multiline->label_->get_display().color_};
+                auto        glyph{
+                        bar ? characters.crossing_ : characters.vertical_bar_
+                };
+                bool        starts_bar{false};
+
+                if (row == GutterRow::Code &&
+                    multiline->start_line_ == line_nr) {
+                    glyph = bar ? characters.line_top_middle_
+                                : characters.line_top_left_;
+                    starts_bar = true;
+                } else if (row == GutterRow::Code &&
+                           multiline->end_line_ == line_nr) {
+                    glyph      = bar ? characters.crossing_
+                                     : characters.branch_left_;
+                    starts_bar = true;
+                } else if (row == GutterRow::Closing && lane == closing_lane) {
+                    glyph      = characters.line_bottom_left_;
+                    starts_bar = true;
+                } else if (row == GutterRow::Elision) {
+                    glyph = characters.vertical_interruption_;
+                }
+
+                print_colored(glyph, color);
+                if (starts_bar) {
+                    bar       = true;
+                    bar_color = color;
+                }
+            }
+
+            if (bar)
+                print_colored(characters.horizontal_bar_, bar_color);
+            else
+                *sink_ << ' ';
+        }
+
+        if (row == GutterRow::Code && bar) {
+            print_colored(characters.arrow_right_, bar_color);
+            *sink_ << ' ';
+        } else if (row == GutterRow::Closing) {
+            print_colored(characters.horizontal_bar_, bar_color);
+            print_colored(characters.horizontal_bar_, bar_color);
+        } else {
+            *sink_ << "  ";
+        }
+    }
+
+    void ReportPrinter::print_closing_labels(std::size_t line_nr) const {
+        // right to left, so no bar has to cross a lane that is yet to close
+        for (auto lane{lane_count_}; lane-- > 0;) {
+            for (auto const &multiline : multiline_labels_) {
+                if (multiline.lane_ != lane || multiline.end_line_ != line_nr)
+                    continue;
+
+                print_non_code_line_start();
+                print_gutter(line_nr, GutterRow::Closing, lane);
+
+                auto const &display{multiline.label_->get_display()};
+                if (display.message_.has_value()) {
+                    *sink_ << ' ';
+                    display.message_->write(*sink_);
+                }
+                end_line();
+            }
+        }
     }
 
     void ReportPrinter::print_line_segment(
             Line const &line, internal::ColoredSpan const &colored_span
     ) const {
-        auto const &[span, label_ptr]{colored_span};
+        auto const &[span, label_ptr, multiline]{colored_span};
 
         auto const content{report_->source_->get_line(line, span)};
         if (label_ptr == nullptr) {
-            *os_ << content;
+            *sink_ << content;
             return;
         }
 
-        label_ptr->get_display().print(*os_, content);
+        label_ptr->get_display().print(*sink_, content, get_color_mode());
     }
 
     void ReportPrinter::print_highlight(
             internal::ColoredSpan const &colored_span
     ) const {
         auto const &characters{get_characters()};
-        auto const &[span, label_ptr]{colored_span};
+        auto const &[span, label_ptr, multiline]{colored_span};
         auto const highlight_size{colored_span.center_offset()};
-        auto const highlight_left{[&] {
-            std::string highlight{};
-            highlight.reserve(characters.highlight_.size() * highlight_size);
-
-            for (std::size_t i{0}; i < highlight_size; ++i) {
-                highlight += characters.highlight_;
-            }
+        auto const &display{label_ptr->get_display()};
 
-            return highlight;
-        }()};
-        auto const highlight_right{[&] {
-            std::string highlight{highlight_left};
-            if (span.size() % 2 == 0) {
-                highlight += characters.highlight_;
-            }
+        if (display.color_.has_value())
+            start_color(*display.color_);
 
-            return highlight;
-        }()};
+        for (std::size_t i{0}; i < highlight_size; ++i) {
+            *sink_ << characters.highlight_;
+        }
+        *sink_ << characters.highlight_center_;
+        for (std::size_t i{0}; i < highlight_size + (span.size() % 2 == 0);
+             ++i) {
+            *sink_ << characters.highlight_;
+        }
 
-        label_ptr->get_display().print(
-                *os_,
-                highlight_left + characters.highlight_center_ + highlight_right
-        );
+        if (display.color_.has_value())
+            end_color();
     }
 
     void ReportPrinter::print_highlight_lines(
@@ -153,61 +703,104 @@ namespace mjolnir {
         auto const &characters{get_characters()};
         auto const &[line, colored_spans]{spanned_line};
 
-        int line_pos{0};
-        for (auto span_it{colored_spans.cbegin()};
-             span_it != colored_spans.cend(); ++span_it) {
-            auto const &[span, label_ptr]{*span_it};
+        struct Highlight final {
+            internal::ColoredSpan const *colored_span_;
+            // the column the highlight starts at
+            std::size_t                  start_;
+        };
 
-            if (!span_it->is_highlight() ||
-                !span_it->is_single_line_highlightable(*report_->source_)) {
-                line_pos += span.size();
-                continue;
+        std::pmr::vector<Highlight> highlights{report_->get_allocator()};
+        std::size_t                 line_pos{0};
+        for (auto const &colored_span : colored_spans) {
+            if (colored_span.is_highlight())
+                highlights.emplace_back(Highlight{&colored_span, line_pos});
+
+            line_pos += colored_span.span_.size();
+        }
+
+        // The row below each message has a connector for every highlight
+        // after it, so every row ends the same way as the one after it. The
+        // connectors are drawn once, each row printing the part it needs.
+        std::pmr::string              connectors{report_->get_allocator()};
+        PmrStringSink                 connectors_sink{connectors};
+        std::pmr::vector<std::size_t> connector_offsets{
+                report_->get_allocator()
+        };
+        connector_offsets.reserve(highlights.size() + 1);
+        for (std::size_t i{0}; i < highlights.size(); ++i) {
+            connector_offsets.emplace_back(connectors.size());
+
+            auto const &[colored_span, start]{highlights[i]};
+            auto const &display{colored_span->label_ptr_->get_display()};
+            if (display.color_.has_value())
+                start_color(connectors_sink, *display.color_);
+
+            connectors_sink << characters.vertical_bar_;
+            end_color(connectors_sink);
+
+            if (i + 1 < highlights.size()) {
+                auto const &[next, next_start]{highlights[i + 1]};
+                connectors_sink.fill(
+                        ' ', next_start - start - 1 + next->center_offset()
+                );
             }
+        }
+        connector_offsets.emplace_back(connectors.size());
+
+        // The horizontal bars leading up to the messages all end in about
+        // the same column, so they're all cut from the longest.
+        auto const max_span_end{spanned_line.max_span_end()};
+        auto const bar_count{[&](Highlight const &highlight) {
+            auto const &[colored_span, start]{highlight};
+            auto const end{start + colored_span->span_.size()};
+            auto const bars_end{
+                    max_span_end + colored_span->center_offset() -
+                    colored_span->span_.size() % 2 + padding_past_max
+            };
 
-            print_non_code_line_start();
+            return bars_end > end ? bars_end - end : 0;
+        }};
 
-            {
-                auto const center_offset{span_it->center_offset()};
-                *os_ << std::string(line_pos + center_offset, ' ');
-                line_pos += span_it->span_.size();
-
-                auto const &display{label_ptr->get_display()};
-                *os_ << display.color_->fg_start()
-                     << characters.line_bottom_left_;
-
-                auto const max_span_end{spanned_line.max_span_end()};
-                for (auto current_offset{line_pos};
-                     current_offset < max_span_end + span_it->center_offset() -
-                                              span_it->span_.size() % 2 +
-                                              padding_past_max;
-                     ++current_offset) {
-                    *os_ << characters.horizontal_bar_;
-                }
+        std::pmr::string bars{report_->get_allocator()};
+        PmrStringSink    bars_sink{bars};
+        std::size_t      max_bar_count{0};
+        for (auto const &highlight : highlights) {
+            max_bar_count = std::max(max_bar_count, bar_count(highlight));
+        }
+        for (std::size_t i{0}; i < max_bar_count; ++i) {
+            bars_sink << characters.horizontal_bar_;
+        }
 
-                *os_ << Color::end << ' ' << display.message_.value();
-            }
+        std::string_view const connectors_view{connectors};
+        std::string_view const bars_view{bars};
+        for (std::size_t i{0}; i < highlights.size(); ++i) {
+            auto const &[colored_span, start]{highlights[i]};
+            auto const &display{colored_span->label_ptr_->get_display()};
 
+            print_non_code_line_start();
+            print_gutter(line.line_number_, GutterRow::Annotation);
+
+            sink_->fill(' ', start + colored_span->center_offset());
+            if (display.color_.has_value())
+                start_color(*display.color_);
+
+            *sink_ << characters.line_bottom_left_
+                   << bars_view.substr(
+                              0, bar_count(highlights[i]) *
+                                         characters.horizontal_bar_.size()
+                      );
+            end_color();
+            *sink_ << ' ';
+            display.message_->write(*sink_);
             end_line();
 
             print_non_code_line_start();
+            print_gutter(line.line_number_, GutterRow::Annotation);
 
-            int rest_line_padding{line_pos};
-            for (auto rest_it{std::next(span_it)};
-                 rest_it != colored_spans.cend(); ++rest_it) {
-                auto const &[rest_span, rest_label_ptr]{*rest_it};
-                if (!rest_it->is_highlight() ||
-                    !rest_it->is_single_line_highlightable(*report_->source_)) {
-                    rest_line_padding += rest_span.size();
-                    continue;
-                }
-
-                auto const center_offset{rest_it->center_offset()};
-                *os_ << std::string(rest_line_padding + center_offset, ' ');
-                rest_line_padding = rest_span.size() - 1;
-
-                *os_ << rest_label_ptr->get_display().color_->fg(
-                        characters.vertical_bar_
-                );
+            if (i + 1 < highlights.size()) {
+                auto const &[next, next_start]{highlights[i + 1]};
+                sink_->fill(' ', next_start + next->center_offset());
+                *sink_ << connectors_view.substr(connector_offsets[i + 1]);
             }
             end_line();
         }
@@ -222,18 +815,18 @@ namespace mjolnir {
             return;
 
         print_non_code_line_start();
+        print_gutter(line.line_number_, GutterRow::Annotation);
 
         std::size_t highlight_start{0};
         for (auto const &colored_span : colored_spans) {
-            auto const &[span, label_ptr]{colored_span};
+            auto const &[span, label_ptr, multiline]{colored_span};
 
-            if (!colored_span.is_highlight() ||
-                !colored_span.is_single_line_highlightable(*report_->source_)) {
+            if (!colored_span.is_highlight()) {
                 highlight_start += span.size();
                 continue;
             }
 
-            *os_ << std::string(highlight_start, ' ');
+            sink_->fill(' ', highlight_start);
             highlight_start = 0;
             print_highlight(colored_span);
         }
@@ -241,18 +834,40 @@ namespace mjolnir {
         print_highlight_lines(spanned_line);
     }
 
-    void
-    ReportPrinter::print_line(internal::SpannedLine const &spanned_line) const {
-        for (auto const &[line, colored_spans]{spanned_line};
-             auto const &colored_span : colored_spans) {
-            print_line_segment(line, colored_span);
+    void ReportPrinter::print_line(
+            internal::SpannedLine const &spanned_line, Window const &window
+    ) const {
+        auto const &[line, colored_spans]{spanned_line};
+        auto const &[shown_line, pieces]{window};
+
+        if (pieces.empty()) {
+            for (auto const &colored_span : colored_spans) {
+                print_line_segment(line, colored_span);
+            }
+
+            end_line();
+            return;
+        }
+
+        for (std::size_t i{0}; i < pieces.size(); ++i) {
+            auto const &[head, cut, tail]{pieces[i]};
+            auto const &[span, label_ptr, multiline]{shown_line.spans_[i]};
+
+            print_line_segment(line, {head, label_ptr, multiline});
+            if (!cut)
+                continue;
+
+            start_color(colors::gray);
+            *sink_ << get_characters().ellipsis_;
+            end_color();
+            print_line_segment(line, {tail, label_ptr, multiline});
         }
 
         end_line();
     }
 
     void ReportPrinter::end_line() const {
-        *os_ << '\n';
+        *sink_ << '\n';
     }
 
     void ReportPrinter::print_header() const {
@@ -264,13 +879,15 @@ namespace mjolnir {
         if (std::holds_alternative<BasicReportKind>(report_->kind_) &&
             std::get<BasicReportKind>(report_->kind_) !=
                     BasicReportKind::Continuation) {
-            *os_ << color.fg_start();
+            start_color(color);
             if (report_->code_.has_value()) {
-                *os_ << '[' << report_->code_.value() << "] ";
+                *sink_ << '[' << report_->code_.value() << "] ";
             }
-            *os_ << kind << Color::end;
+            *sink_ << kind;
+            end_color();
             if (report_->message_.has_value()) {
-                *os_ << ": " << report_->message_.value();
+                *sink_ << ": ";
+                report_->message_->write(*sink_);
             }
             end_line();
         }
@@ -279,10 +896,10 @@ namespace mjolnir {
         auto const line_nr{line->line_number_};
         auto const col{line->get_column(report_->start_pos_)};
 
-        *os_ << line_number_space_ << characters.line_top_left_
-             << characters.horizontal_bar_ << characters.box_left_
-             << report_->source_->get_name() << ':' << line_nr << ':' << col
-             << characters.box_right_;
+        *sink_ << line_number_space_ << characters.line_top_left_
+               << characters.horizontal_bar_ << characters.box_left_
+               << report_->source_->get_name() << ':' << line_nr << ':' << col
+               << characters.box_right_;
         end_line();
     }
 
@@ -292,41 +909,137 @@ namespace mjolnir {
         for (int i{0}; i < line_number_padding_before + max_line_nr_len_ +
                                    line_number_padding_after;
              ++i) {
-            *os_ << characters.horizontal_bar_;
+            *sink_ << characters.horizontal_bar_;
         }
 
-        *os_ << characters.line_bottom_right_;
+        *sink_ << characters.line_bottom_right_;
         end_line();
     }
 
     void ReportPrinter::print_empty_line() const {
         auto const &characters{get_characters()};
 
-        *os_ << line_number_space_ << characters.vertical_bar_ << '\n';
+        *sink_ << line_number_space_ << characters.vertical_bar_ << '\n';
+    }
+
+    std::string ReportPrinter::get_snippet_key() const {
+        std::string key;
+
+        append_bytes(key, report_->source_->get_revision());
+        append_bytes(key, get_color_mode());
+        append_bytes(key, report_->config_.context_lines);
+        append_bytes(key, report_->config_.max_line_width.has_value());
+        append_bytes(key, report_->config_.max_line_width.value_or(0));
+
+        auto const &characters{get_characters()};
+        for (auto const glyph :
+             {characters.horizontal_bar_, characters.vertical_bar_,
+              characters.vertical_interruption_, characters.crossing_,
+              characters.arrow_up_, characters.arrow_right_,
+              characters.line_top_left_, characters.line_top_right_,
+              characters.line_top_middle_, characters.line_bottom_left_,
+              characters.line_bottom_right_, characters.line_bottom_middle_,
+              characters.branch_left_, characters.branch_right_,
+              characters.highlight_center_, characters.highlight_,
+              characters.box_left_, characters.box_right_,
+              characters.ellipsis_}) {
+            append_text(key, glyph);
+        }
+
+        for (auto const &label : report_->labels_) {
+            auto const &span{label.get_span()};
+            append_bytes(key, span.start());
+            append_bytes(key, span.end());
+
+            auto const &display{label.get_display()};
+            append_bytes(key, display.color_.has_value());
+            if (display.color_.has_value())
+                append_text(key, display.color_->fg_start());
+
+            append_bytes(key, display.message_.has_value());
+            if (display.message_.has_value())
+                append_text(key, display.message_->get_text());
+        }
+
+        return key;
     }
 
     void ReportPrinter::print_lines() const {
-        auto const spanned_lines{get_spanned_lines()};
+        auto *const cache{report_->config_.snippet_cache};
+        if (cache == nullptr) {
+            write_lines();
+            return;
+        }
+
+        auto key{get_snippet_key()};
+        if (auto const body{cache->find(key)}) {
+            *sink_ << *body;
+            return;
+        }
+
+        auto       body{std::make_shared<std::string>()};
+        StringSink body_sink{*body};
+        ReportPrinter{*this, body_sink}.write_lines();
+
+        *sink_ << *body;
+        cache->insert(std::move(key), std::move(body));
+    }
+
+    void ReportPrinter::write_lines() const {
+        auto const layout{get_spanned_lines()};
+
+        std::pmr::vector<internal::ColoredSpan> window_spans{
+                report_->get_allocator()
+        };
+        std::pmr::vector<Piece> window_pieces{report_->get_allocator()};
+        std::optional<std::size_t> previous_line_nr{};
+        for (auto const &spanned_line : layout.lines_) {
+            auto const line_nr{spanned_line.line_.line_number_};
+
+            // lines skipped inside a multi-line label get a gap line
+            if (previous_line_nr.has_value() &&
+                line_nr > *previous_line_nr + 1 &&
+                std::ranges::any_of(
+                        multiline_labels_,
+                        [&](MultilineLabel const &multiline) {
+                            return multiline.start_line_ <= *previous_line_nr &&
+                                   line_nr <= multiline.end_line_;
+                        }
+                )) {
+                print_non_code_line_start();
+                print_gutter(*previous_line_nr, GutterRow::Elision);
+                end_line();
+            }
+
+            print_line_start(line_nr);
+            print_gutter(line_nr, GutterRow::Code);
+            auto const window{
+                    get_window(spanned_line, window_spans, window_pieces)
+            };
+            print_line(spanned_line, window);
+            print_highlights(window.line_);
+            print_closing_labels(line_nr);
 
-        for (auto const &spanned_line : spanned_lines) {
-            print_line_start(spanned_line.line_.line_number_);
-            print_line(spanned_line);
-            print_highlights(spanned_line);
+            previous_line_nr = line_nr;
         }
     }
 
     void ReportPrinter::print_help() const {
         for (auto const &help : report_->help_) {
             print_non_code_line_start();
-            *os_ << colors::light_blue.fg_start() << "Help: " << Color::end
-                 << help;
+            start_color(colors::light_blue);
+            *sink_ << "Help: ";
+            end_color();
+            help.write(*sink_);
             end_line();
         }
 
         for (auto const &note : report_->notes_) {
             print_non_code_line_start();
-            *os_ << colors::light_cyan.fg_start() << "Note: " << Color::end
-                 << note;
+            start_color(colors::light_cyan);
+            *sink_ << "Note: ";
+            end_color();
+            note.write(*sink_);
             end_line();
         }
     }
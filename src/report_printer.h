@@ -1,21 +1,22 @@
 #ifndef REPORT_PRINTER_H
 #define REPORT_PRINTER_H
 
-#include <algorithm>         // for max_element
+#include <algorithm>         // for max
 #include <cassert>           // for assert
 #include <cstddef>           // for size_t
+#include <memory_resource>   // for polymorphic_allocator
 #include <mjolnir/report.hpp>// for Report
-#include <set>               // for operator==, set
-#include <sstream>           // for ostream
-#include <string>            // for string, to_string
-#include <utility>           // for as_const
+#include <optional>          // for optional
+#include <span>              // for span
+#include <string>            // for string
+#include <vector>            // for vector
 
+#include "mjolnir/color.hpp" // for Color, ColorMode
+#include "mjolnir/sink.hpp"  // for Sink
 #include "mjolnir/source.hpp"// for Line, SpannedLine
+#include "mjolnir/span.hpp"  // for ColoredSpan, Span
 
 namespace mjolnir {
-    namespace internal {
-        struct ColoredSpan;
-    }// namespace internal
     struct Characters;
 
     class ReportPrinter final {
@@ -24,39 +25,150 @@ namespace mjolnir {
         static constexpr auto padding_after_vert_bar{1};
         static constexpr auto padding_past_max{2};
 
-        std::ostream  *os_;
-        Report const  *report_;
-        std::set<Line> lines_{report_->get_lines()};
-        std::size_t    max_line_nr_len_{[this] {
-            auto const max_line = std::ranges::max_element(
-                    std::as_const(lines_),
-                    [](Line const &lhs, Line const &rhs) { return lhs < rhs; }
-            );
-            assert(max_line != lines_.cend());// should not be possible
+        struct LabelLines final {
+            std::optional<Line> start_;
+            std::optional<Line> end_;
+        };
+
+        // A label spanning several lines. It is drawn in a lane of the
+        // gutter between the line numbers and the code, from its first line
+        // down to its last, below which its message goes.
+        struct MultilineLabel final {
+            Label const *label_;
+            std::size_t  start_line_;
+            std::size_t  end_line_;
+            std::size_t  lane_;
+        };
+
+        // What a row of the gutter is drawn next to.
+        enum class GutterRow {
+            Code,
+            // anything printed below a line of code
+            Annotation,
+            // lines left out, below the line given
+            Elision,
+            // the message of the label in the closing lane
+            Closing
+        };
+
+        // The spanned lines of a report, in order, with the segments of all
+        // of them stored back to back in one vector.
+        struct Layout final {
+            std::pmr::vector<internal::ColoredSpan> spans_;
+            std::pmr::vector<internal::SpannedLine> lines_;
+        };
+
+        // What is printed of a segment of a line cut down to fit: its head,
+        // followed by a marker and its tail if its middle was cut out.
+        struct Piece final {
+            Span head_;
+            bool cut_;
+            Span tail_;
+        };
 
-            return std::to_string(max_line->line_number_).size();
+        // A line as printed. Unless it is printed whole, its segments are
+        // laid out in columns rather than bytes, one for each piece.
+        struct Window final {
+            internal::SpannedLine  line_;
+            std::span<Piece const> pieces_;
+        };
+
+        Sink                            *sink_;
+        Report const                    *report_;
+        std::pmr::vector<LabelLines>     label_lines_{resolve_label_lines()};
+        std::pmr::vector<MultilineLabel> multiline_labels_{
+                get_multiline_labels()
+        };
+        std::size_t                      lane_count_{[this] {
+            std::size_t lanes{0};
+            for (auto const &multiline : multiline_labels_) {
+                lanes = std::max(lanes, multiline.lane_ + 1);
+            }
+
+            return lanes;
+        }()};
+        std::size_t                      max_line_nr_len_{[this] {
+            std::size_t max_line_nr{0};
+            for (auto const &[start, end] : label_lines_) {
+                if (start.has_value())
+                    max_line_nr = std::max(max_line_nr, start->line_number_);
+
+                if (end.has_value())
+                    max_line_nr = std::max(max_line_nr, end->line_number_);
+            }
+            assert(max_line_nr != 0);// should not be possible
+
+            return digit_count(get_last_shown_line_nr(max_line_nr));
         }()};
-        std::string    line_number_space_{[this] {
+        std::string                      line_number_space_{[this] {
             return std::string(
                     line_number_padding_before + max_line_nr_len_ +
                             line_number_padding_after,
                     ' '
             );
         }()};
-        std::string    padding_after_vert_bar_str_{
+        std::string                      padding_after_vert_bar_str_{
                 std::string(padding_after_vert_bar, ' ')
         };
 
+        // Resolves the lines of every label's start and end in one go.
+        [[nodiscard]]
+        std::pmr::vector<LabelLines> resolve_label_lines() const;
+
+        // Assigns every multi-line label a lane, reusing those of labels that
+        // have ended by the time it starts.
+        [[nodiscard]]
+        std::pmr::vector<MultilineLabel> get_multiline_labels() const;
+
+        // The last line printed, counting the context lines after the last
+        // labelled one.
+        [[nodiscard]]
+        std::size_t get_last_shown_line_nr(std::size_t last_labelled) const;
+
+        [[nodiscard]]
+        static std::size_t digit_count(std::size_t number) noexcept;
+
         [[nodiscard]]
         Characters const &get_characters() const noexcept;
 
         [[nodiscard]]
-        std::set<internal::SpannedLine> get_spanned_lines() const;
+        ColorMode get_color_mode() const noexcept;
+
+        // Both write nothing at all when colors are turned off.
+        void start_color(Color const &color) const;
+
+        void start_color(Sink &sink, Color const &color) const;
+
+        void end_color() const;
+
+        void end_color(Sink &sink) const;
+
+        [[nodiscard]]
+        Layout get_spanned_lines() const;
+
+        // Narrows a line wider than the configured maximum down to its
+        // labelled columns. What is left of it is put in `spans` and
+        // `pieces`, which the window points into.
+        [[nodiscard]]
+        Window get_window(
+                internal::SpannedLine const             &spanned_line,
+                std::pmr::vector<internal::ColoredSpan> &spans,
+                std::pmr::vector<Piece>                 &pieces
+        ) const;
 
         void print_line_start(std::size_t line_nr) const;
 
         void print_non_code_line_start() const;
 
+        // Draws the lanes of the multi-line labels, if there are any.
+        void print_gutter(
+                std::size_t line_nr, GutterRow row,
+                std::size_t closing_lane = 0
+        ) const;
+
+        // The last row of every multi-line label ending on this line.
+        void print_closing_labels(std::size_t line_nr) const;
+
         void print_line_segment(
                 Line const &line, internal::ColoredSpan const &colored_span
         ) const;
@@ -68,13 +180,36 @@ namespace mjolnir {
 
         void print_highlights(internal::SpannedLine const &spanned_line) const;
 
-        void print_line(internal::SpannedLine const &spanned_line) const;
+        void print_line(
+                internal::SpannedLine const &spanned_line, Window const &window
+        ) const;
 
         void end_line() const;
 
+        // Everything the lines printed by print_lines depend on, for the
+        // snippet cache to look them up by.
+        [[nodiscard]]
+        std::string get_snippet_key() const;
+
+        void write_lines() const;
+
+        // The same printer, writing somewhere else.
+        ReportPrinter(ReportPrinter const &other, Sink &sink)
+            : sink_{&sink}
+            , report_{other.report_}
+            , label_lines_{other.label_lines_, other.report_->get_allocator()}
+            , multiline_labels_{
+                      other.multiline_labels_, other.report_->get_allocator()
+              }
+            , lane_count_{other.lane_count_}
+            , max_line_nr_len_{other.max_line_nr_len_}
+            , line_number_space_{other.line_number_space_}
+            , padding_after_vert_bar_str_{other.padding_after_vert_bar_str_} {
+        }
+
     public:
-        ReportPrinter(std::ostream &os, Report const &report)
-            : os_{&os}
+        ReportPrinter(Sink &sink, Report const &report)
+            : sink_{&sink}
             , report_{&report} {
         }
 
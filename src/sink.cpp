@@ -0,0 +1,229 @@
+#include "mjolnir/sink.hpp"// for Sink, OstreamSink, StringSink, PmrStringSink
+
+#include <algorithm>   // for copy_n, fill_n, min
+#include <array>       // for array
+#include <cerrno>      // for errno, EINTR
+#include <charconv>    // for to_chars
+#include <limits>      // for numeric_limits
+#include <memory>      // for make_unique_for_overwrite
+#include <ostream>     // for ostream
+#include <span>        // for span
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <system_error>// for system_error, error_code, system_category
+
+#include <unistd.h>// for write
+#if __has_include(<sys/uio.h>)
+#define MJOLNIR_HAS_WRITEV
+#include <sys/uio.h>// for writev, iovec
+#endif
+
+namespace mjolnir {
+    void Sink::fill(char c, std::size_t count) {
+        std::array<char, 64> chunk;
+        chunk.fill(c);
+
+        while (count > 0) {
+            auto const size{std::min(count, chunk.size())};
+            write({chunk.data(), size});
+            count -= size;
+        }
+    }
+
+    void Sink::flush() {
+    }
+
+    Sink &operator<<(Sink &sink, std::string_view text) {
+        sink.write(text);
+        return sink;
+    }
+
+    Sink &operator<<(Sink &sink, char c) {
+        sink.write({&c, 1});
+        return sink;
+    }
+
+    Sink &operator<<(Sink &sink, std::size_t number) {
+        std::array<char, std::numeric_limits<std::size_t>::digits10 + 1> digits;
+
+        auto const [end, _]{
+                std::to_chars(digits.data(), digits.data() + digits.size(), number)
+        };
+        sink.write({digits.data(), end});
+        return sink;
+    }
+
+    OstreamSink::OstreamSink(std::ostream &os) noexcept
+        : os_{&os} {
+    }
+
+    void OstreamSink::write(std::string_view text) {
+        auto const size{static_cast<std::streamsize>(text.size())};
+
+        auto *const buffer{os_->rdbuf()};
+        if (buffer == nullptr || buffer->sputn(text.data(), size) != size)
+            os_->setstate(std::ios::badbit);
+    }
+
+    void OstreamSink::flush() {
+        os_->flush();
+    }
+
+    StringSink::StringSink(std::string &string) noexcept
+        : string_{&string} {
+    }
+
+    void StringSink::write(std::string_view text) {
+        string_->append(text);
+    }
+
+    void StringSink::fill(char c, std::size_t count) {
+        string_->append(count, c);
+    }
+
+    PmrStringSink::PmrStringSink(std::pmr::string &string) noexcept
+        : string_{&string} {
+    }
+
+    void PmrStringSink::write(std::string_view text) {
+        string_->append(text);
+    }
+
+    void PmrStringSink::fill(char c, std::size_t count) {
+        string_->append(count, c);
+    }
+
+    BufferSink::BufferSink(std::span<char> buffer) noexcept
+        : buffer_{buffer} {
+    }
+
+    void BufferSink::write(std::string_view text) {
+        auto const size{std::min(text.size(), buffer_.size() - size_)};
+        truncated_ = truncated_ || size != text.size();
+
+        std::copy_n(text.data(), size, buffer_.data() + size_);
+        size_ += size;
+    }
+
+    void BufferSink::fill(char c, std::size_t count) {
+        auto const size{std::min(count, buffer_.size() - size_)};
+        truncated_ = truncated_ || size != count;
+
+        std::fill_n(buffer_.data() + size_, size, c);
+        size_ += size;
+    }
+
+    std::string_view BufferSink::view() const noexcept {
+        return {buffer_.data(), size_};
+    }
+
+    bool BufferSink::is_truncated() const noexcept {
+        return truncated_;
+    }
+
+    FdSink::FdSink(int fd, std::size_t capacity)
+        : fd_{fd}
+        , capacity_{std::max<std::size_t>(capacity, 1)} {
+        buffer_ = std::make_unique_for_overwrite<char[]>(capacity_);
+    }
+
+    FdSink::~FdSink() {
+        try {
+            flush();
+        } catch (std::system_error const &) {
+            // nowhere left to report it
+        }
+    }
+
+    void FdSink::write_out(std::string_view text) {
+        // Either way the buffer is spent, so a failed write isn't retried
+        // with the same data on the next flush.
+        std::string_view const buffered{buffer_.get(), size_};
+        size_ = 0;
+
+#ifdef MJOLNIR_HAS_WRITEV
+        std::array<iovec, 2> chunks{
+                {{const_cast<char *>(buffered.data()), buffered.size()},
+                 {const_cast<char *>(text.data()), text.size()}}
+        };
+        std::span<iovec> pending{chunks};
+
+        while (!pending.empty()) {
+            if (pending.front().iov_len == 0) {
+                pending = pending.subspan(1);
+                continue;
+            }
+
+            auto const written{::writev(
+                    fd_, pending.data(), static_cast<int>(pending.size())
+            )};
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                throw std::system_error{
+                        std::error_code{errno, std::system_category()}, "writev"
+                };
+            }
+
+            // a short write can stop anywhere, even in the middle of a chunk
+            for (auto remaining{static_cast<std::size_t>(written)};
+                 remaining > 0;) {
+                auto      &chunk{pending.front()};
+                auto const size{std::min(remaining, chunk.iov_len)};
+
+                chunk.iov_base = static_cast<char *>(chunk.iov_base) + size;
+                chunk.iov_len -= size;
+                remaining -= size;
+
+                if (chunk.iov_len == 0)
+                    pending = pending.subspan(1);
+            }
+        }
+#else
+        for (auto chunk : {buffered, text}) {
+            while (!chunk.empty()) {
+                auto const written{::write(fd_, chunk.data(), chunk.size())};
+                if (written < 0) {
+                    if (errno == EINTR)
+                        continue;
+
+                    throw std::system_error{
+                            std::error_code{errno, std::system_category()},
+                            "write"
+                    };
+                }
+
+                chunk.remove_prefix(static_cast<std::size_t>(written));
+            }
+        }
+#endif
+    }
+
+    void FdSink::write(std::string_view text) {
+        if (text.size() > capacity_ - size_) {
+            write_out(text);
+            return;
+        }
+
+        std::copy_n(text.data(), text.size(), buffer_.get() + size_);
+        size_ += text.size();
+    }
+
+    void FdSink::fill(char c, std::size_t count) {
+        while (count > 0) {
+            if (size_ == capacity_)
+                write_out({});
+
+            auto const size{std::min(count, capacity_ - size_)};
+            std::fill_n(buffer_.get() + size_, size, c);
+            size_ += size;
+            count -= size;
+        }
+    }
+
+    void FdSink::flush() {
+        if (size_ > 0)
+            write_out({});
+    }
+}// namespace mjolnir
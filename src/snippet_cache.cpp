@@ -0,0 +1,65 @@
+#include "mjolnir/snippet_cache.hpp"// for SnippetCache, CacheStats
+
+#include <atomic>     // for memory_order
+#include <cstddef>    // for size_t
+#include <memory>     // for shared_ptr
+#include <mutex>      // for lock_guard
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <utility>    // for move
+
+namespace mjolnir {
+    SnippetCache::SnippetCache(std::size_t capacity)
+        : capacity_{capacity} {
+    }
+
+    std::shared_ptr<std::string const>
+    SnippetCache::find(std::string_view key) {
+        std::lock_guard const lock{mutex_};
+
+        auto const it{index_.find(key)};
+        if (it == index_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->body_;
+    }
+
+    void SnippetCache::insert(
+            std::string key, std::shared_ptr<std::string const> body
+    ) {
+        if (capacity_ == 0)
+            return;
+
+        std::lock_guard const lock{mutex_};
+
+        // another thread may have rendered the same snippet in the meantime
+        if (auto const it{index_.find(key)}; it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+
+        if (entries_.size() == capacity_) {
+            index_.erase(entries_.back().key_);
+            entries_.pop_back();
+        }
+
+        entries_.emplace_front(Entry{std::move(key), std::move(body)});
+        index_.emplace(entries_.front().key_, entries_.begin());
+    }
+
+    CacheStats SnippetCache::get_stats() const noexcept {
+        return {.hits   = hits_.load(std::memory_order_relaxed),
+                .misses = misses_.load(std::memory_order_relaxed)};
+    }
+
+    void SnippetCache::clear() {
+        std::lock_guard const lock{mutex_};
+
+        index_.clear();
+        entries_.clear();
+    }
+}// namespace mjolnir
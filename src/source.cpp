@@ -1,31 +1,109 @@
-#include <algorithm>         // for max, min, upper_bound, __any_of_fn
+#include <algorithm>         // for max, min, upper_bound, sort, equal, partit...
+#include <atomic>            // for atomic, memory_order
+#include <bit>               // for bit_floor, countr_zero
 #include <cstddef>           // for size_t
+#include <cstdint>           // for uint64_t
+#include <filesystem>        // for path
 #include <functional>        // for hash
-#include <iterator>          // for distance, next
+#include <iterator>          // for distance, next, prev
+#include <memory>            // for make_shared, shared_ptr
+#include <memory_resource>   // for polymorphic_allocator
 #include <mjolnir/source.hpp>// for Line, Source, SpannedLine, Label, Labe...
+#include <mutex>             // for lock_guard, unique_lock
+#include <numeric>           // for iota
 #include <optional>          // for optional, nullopt, nullopt_t
-#include <set>               // for operator==, set, _Rb_tree_const_iterator
+#include <span>              // for span
 #include <sstream>           // for basic_ostream, char_traits, ostream
+#include <stdexcept>         // for invalid_argument, out_of_range
 #include <string>            // for basic_string, string, operator<<
 #include <string_view>       // for string_view, operator<<
 #include <utility>           // for move
 #include <vector>            // for vector
 
+#include "line_scanner.h"   // for scan_lines
+#include "mapped_file.h"    // for map_file
 #include "mjolnir/color.hpp"// for Color
+#include "mjolnir/sink.hpp" // for Sink, OstreamSink
 #include "mjolnir/span.hpp" // for Span, ColoredSpan
 
 namespace mjolnir {
-    void LabelDisplay::print(std::ostream &os, std::string_view message) const {
-        if (color_.has_value()) {
-            os << color_.value().fg(message);
+    namespace {
+        [[nodiscard]]
+        std::uint64_t next_revision() noexcept {
+            static std::atomic<std::uint64_t> revision{0};
+
+            return revision.fetch_add(1, std::memory_order_relaxed);
+        }
+    }// namespace
+
+    void LabelDisplay::print(
+            Sink &sink, std::string_view message, ColorMode mode
+    ) const {
+        if (color_.has_value() && mode != ColorMode::None) {
+            sink << color_->fg_start(mode) << message << Color::end;
             return;
         }
 
-        os << message;
+        sink << message;
+    }
+
+    void LabelDisplay::print(std::ostream &os, std::string_view message) const {
+        OstreamSink sink{os};
+        print(sink, message);
+    }
+
+    Label::Label(Span const &span, allocator_type allocator)
+        : span_{span}
+        , resource_{allocator.resource()} {
+    }
+
+    Label::Label(Label const &other)
+        : Label{other, allocator_type{}} {
     }
 
-    Label::Label(Span const &span)
-        : span_{span} {
+    Label::Label(Label const &other, allocator_type allocator)
+        : span_{other.span_}
+        , display_{.message_ = std::nullopt, .color_ = other.display_.color_}
+        , resource_{allocator.resource()} {
+        if (other.display_.message_.has_value())
+            display_.message_.emplace(*other.display_.message_, allocator);
+    }
+
+    Label::Label(Label &&other, allocator_type allocator)
+        : span_{other.span_}
+        , display_{.message_ = std::nullopt, .color_ = other.display_.color_}
+        , resource_{allocator.resource()} {
+        if (other.display_.message_.has_value())
+            display_.message_.emplace(
+                    std::move(*other.display_.message_), allocator
+            );
+    }
+
+    Label &Label::operator=(Label const &other) {
+        if (this != &other)
+            *this = Label{other, get_allocator()};
+
+        return *this;
+    }
+
+    Label &Label::operator=(Label &&other) {
+        if (this == &other)
+            return *this;
+
+        span_           = other.span_;
+        display_.color_ = other.display_.color_;
+        if (other.display_.message_.has_value())
+            display_.message_.emplace(
+                    std::move(*other.display_.message_), get_allocator()
+            );
+        else
+            display_.message_.reset();
+
+        return *this;
+    }
+
+    Label::allocator_type Label::get_allocator() const noexcept {
+        return resource_;
     }
 
     Span const &Label::get_span() const noexcept {
@@ -36,8 +114,8 @@ namespace mjolnir {
         return display_;
     }
 
-    Label &Label::with_message(std::string message) {
-        display_.message_ = std::move(message);
+    Label &Label::with_message(std::string_view message) {
+        display_.message_.emplace(message, get_allocator());
         return *this;
     }
 
@@ -78,7 +156,7 @@ namespace mjolnir {
     }
 
     bool internal::SpannedLine::operator==(SpannedLine const &other) const {
-        return line_ == other.line_ && spans_ == other.spans_;
+        return line_ == other.line_ && std::ranges::equal(spans_, other.spans_);
     }
 
     bool internal::SpannedLine::operator<(SpannedLine const &other) const {
@@ -108,45 +186,161 @@ namespace mjolnir {
         return max_span_end - line_.byte_offset_;
     }
 
-    Source::Source(std::string name, std::string_view buffer)
+    Source::Source(
+            std::string name, std::string_view buffer, Indexing indexing,
+            LineTable line_table
+    )
         : name_{std::move(name)}
         , buffer_{buffer}
-        , lines_{[this] {
-            std::vector<Line> lines;
+        , indexing_{indexing}
+        , line_table_{line_table}
+        , revision_{next_revision()} {
+        if (indexing_ == Indexing::Eager)
+            index_through(buffer_.size());
+    }
 
-            auto last{buffer_.cbegin()};
+    Source::Source(Source const &other)
+        : Source{other, std::lock_guard<std::mutex>{other.index_mutex_}} {
+    }
 
-            for (auto it{buffer_.cbegin()}; it != buffer_.cend(); ++it) {
-                std::string_view::const_iterator line_it;
+    Source::Source(Source const &other, std::lock_guard<std::mutex> const &)
+        : name_{other.name_}
+        , storage_{other.storage_}
+        , edit_buffer_{other.edit_buffer_}
+        , buffer_{other.buffer_}
+        , indexing_{other.indexing_}
+        , line_table_{other.line_table_}
+        , lines_{other.lines_}
+        , compact_lines_{other.compact_lines_}
+        , scanned_{other.scanned_}
+        , open_line_start_{other.open_line_start_}
+        , jump_table_{other.jump_table_}
+        , revision_{other.revision_} {
+    }
 
-                if (*it == '\n') {
-                    line_it = it;
-                } else if (std::next(it) == buffer_.cend()) {
-                    line_it = buffer_.cend();
-                } else {
-                    continue;
-                }
+    Source::Source(Source &&other) noexcept
+        : Source{
+                  std::move(other),
+                  std::lock_guard<std::mutex>{other.index_mutex_}
+          } {
+    }
+
+    Source::Source(
+            Source &&other, std::lock_guard<std::mutex> const &
+    ) noexcept
+        : name_{std::move(other.name_)}
+        , storage_{std::move(other.storage_)}
+        , edit_buffer_{std::move(other.edit_buffer_)}
+        , buffer_{other.buffer_}
+        , indexing_{other.indexing_}
+        , line_table_{other.line_table_}
+        , lines_{std::move(other.lines_)}
+        , compact_lines_{std::move(other.compact_lines_)}
+        , scanned_{other.scanned_}
+        , open_line_start_{other.open_line_start_}
+        , jump_table_{std::move(other.jump_table_)}
+        , revision_{other.revision_} {
+    }
+
+    Source &Source::operator=(Source const &other) {
+        if (this != &other)
+            *this = Source{other};
 
-                auto const old_offset{std::distance(buffer_.cbegin(), last)};
-                auto const length{std::distance(last, line_it)};
-                lines.emplace_back(
-                        Line{.byte_offset_ =
-                                     static_cast<std::size_t>(old_offset),
-                             .byte_length_ = static_cast<std::size_t>(length),
-                             .line_number_ = lines.size() + 1}
+        return *this;
+    }
+
+    Source &Source::operator=(Source &&other) noexcept {
+        if (this == &other)
+            return *this;
+
+        std::lock_guard const lock{other.index_mutex_};
+        name_            = std::move(other.name_);
+        storage_         = std::move(other.storage_);
+        edit_buffer_     = std::move(other.edit_buffer_);
+        buffer_          = other.buffer_;
+        indexing_        = other.indexing_;
+        line_table_      = other.line_table_;
+        lines_           = std::move(other.lines_);
+        compact_lines_   = std::move(other.compact_lines_);
+        scanned_         = other.scanned_;
+        open_line_start_ = other.open_line_start_;
+        jump_table_      = std::move(other.jump_table_);
+        revision_        = other.revision_;
+
+        return *this;
+    }
+
+    Source Source::from_file(
+            std::filesystem::path const &path, Indexing indexing,
+            LineTable line_table
+    ) {
+        auto [storage, contents]{internal::map_file(path)};
+
+        Source source{path.string(), contents, indexing, line_table};
+        source.storage_ = std::move(storage);
+
+        return source;
+    }
+
+    void Source::index_through(std::size_t offset) const {
+        // Keep going until the line containing offset has been terminated,
+        // scanning at least a chunk at a time so that walking through a file
+        // offset by offset doesn't rescan in tiny steps. The compact table is
+        // filled a chunk at a time through a small scratch table instead.
+        std::vector<Line> scratch;
+
+        while (scanned_ < buffer_.size() && open_line_start_ <= offset) {
+            if (line_table_ == LineTable::Full) {
+                auto const end{std::min(
+                        buffer_.size(),
+                        std::max(offset + 1, scanned_ + lazy_chunk_size)
+                )};
+
+                open_line_start_ = internal::scan_lines(
+                        buffer_, open_line_start_, scanned_, end, lines_
                 );
+                scanned_ = end;
+                continue;
+            }
+
+            auto const end{std::min(buffer_.size(), scanned_ + lazy_chunk_size)
+            };
 
-                last = line_it + 1;
+            scratch.clear();
+            open_line_start_ = internal::scan_lines(
+                    buffer_, open_line_start_, scanned_, end, scratch
+            );
+            for (auto const &line : scratch) {
+                compact_lines_.push_back(line.byte_offset_);
             }
+            scanned_ = end;
+        }
 
-            return lines;
-        }()} {
+        if (scanned_ == buffer_.size() && open_line_start_ < buffer_.size()) {
+            if (line_table_ == LineTable::Full) {
+                lines_.emplace_back(
+                        Line{.byte_offset_ = open_line_start_,
+                             .byte_length_ = buffer_.size() - open_line_start_,
+                             .line_number_ = lines_.size() + 1}
+                );
+            } else {
+                compact_lines_.push_back(open_line_start_);
+            }
+            open_line_start_ = buffer_.size();
+        }
+
+        if (scanned_ == buffer_.size() && line_table_ == LineTable::Compact)
+            compact_lines_.shrink_to_fit();
     }
 
     std::string_view Source::get_name() const noexcept {
         return name_;
     }
 
+    std::uint64_t Source::get_revision() const noexcept {
+        return revision_;
+    }
+
     std::optional<std::string_view> Source::get_line(std::size_t offset) const {
         auto const lineInfo{get_line_info(offset)};
 
@@ -174,30 +368,420 @@ namespace mjolnir {
         if (offset >= buffer_.size())
             return std::nullopt;
 
-        // TODO: this here below isn't doing what I want it to do
-        auto it{std::upper_bound(
-                lines_.cbegin(), lines_.cend(), offset,
-                [](std::size_t lhs, Line const &rhs) {
-                    return lhs < rhs.byte_offset_;
+        if (indexing_ == Indexing::Eager)
+            return find_line_info(offset);
+
+        std::lock_guard const lock{index_mutex_};
+        index_through(offset);
+
+        return find_line_info(offset);
+    }
+
+    std::vector<std::optional<Line>>
+    Source::resolve(std::span<std::size_t const> offsets) const {
+        std::vector<std::optional<Line>> lines(offsets.size());
+        std::vector<std::size_t>         order(offsets.size());
+
+        resolve_into(offsets, order, lines);
+        return lines;
+    }
+
+    std::pmr::vector<std::optional<Line>> Source::resolve(
+            std::span<std::size_t const> offsets,
+            std::pmr::polymorphic_allocator<> allocator
+    ) const {
+        std::pmr::vector<std::optional<Line>> lines(offsets.size(), allocator);
+        std::pmr::vector<std::size_t>         order(offsets.size(), allocator);
+
+        resolve_into(offsets, order, lines);
+        return lines;
+    }
+
+    void Source::resolve_into(
+            std::span<std::size_t const> offsets,
+            std::span<std::size_t> order,
+            std::span<std::optional<Line>> lines
+    ) const {
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::ranges::sort(order, {}, [&](std::size_t index) {
+            return offsets[index];
+        });
+
+        // everything from here on is past the end of the buffer
+        auto const in_range{std::ranges::partition_point(
+                order, [&](std::size_t index) {
+                    return offsets[index] < buffer_.size();
                 }
         )};
+        if (in_range == order.begin())
+            return;
+
+        std::unique_lock lock{index_mutex_, std::defer_lock};
+        if (indexing_ == Indexing::Lazy) {
+            lock.lock();
+            index_through(offsets[*std::prev(in_range)]);
+        }
+
+        if (line_table_ == LineTable::Compact) {
+            for (auto it{order.begin()}; it != in_range; ++it) {
+                lines[*it] = find_line_info(offsets[*it]);
+            }
+
+            return;
+        }
+
+        auto const by_offset{[](std::size_t lhs, Line const &rhs) {
+            return lhs < rhs.byte_offset_;
+        }};
+
+        std::size_t current{0};
+        for (auto it{order.begin()}; it != in_range; ++it) {
+            auto const offset{offsets[*it]};
+
+            // gallop to a window that contains the first line starting past
+            // offset, then binary search inside of it
+            std::size_t step{1};
+            while (current + step < lines_.size() &&
+                   lines_[current + step].byte_offset_ <= offset) {
+                step *= 2;
+            }
+
+            auto const next{std::upper_bound(
+                    std::next(lines_.cbegin(), current + step / 2),
+                    std::next(
+                            lines_.cbegin(),
+                            std::min(current + step + 1, lines_.size())
+                    ),
+                    offset, by_offset
+            )};
+            if (next == lines_.cbegin())
+                continue;
+
+            current = static_cast<std::size_t>(
+                    std::distance(lines_.cbegin(), next) - 1
+            );
+            lines[*it] = lines_[current];
+        }
+
+    }
+
+    std::optional<Line> Source::find_line_info(std::size_t offset) const {
+        // The line containing offset is the last one starting at or before
+        // it. That also covers offset being a '\n' and the last line, with
+        // or without a trailing newline, as offset is always in the buffer.
+        auto first{std::size_t{0}};
+        auto last{line_count()};
+
+        if (!jump_table_.first_lines_.empty()) {
+            auto const bucket{offset >> jump_table_.shift_};
+            first = jump_table_.first_lines_[bucket];
+            if (bucket + 1 < jump_table_.first_lines_.size())
+                last = jump_table_.first_lines_[bucket + 1] + 1;
+        } else if (line_table_ == LineTable::Compact) {
+            first = compact_lines_.count_starting_at_or_before(offset);
+            last  = first;
+        }
+
+        if (line_table_ == LineTable::Full) {
+            auto const it{std::upper_bound(
+                    std::next(lines_.cbegin(), first),
+                    std::next(lines_.cbegin(), last), offset,
+                    [](std::size_t lhs, Line const &rhs) {
+                        return lhs < rhs.byte_offset_;
+                    }
+            )};
+
+            if (it == lines_.cbegin())
+                return std::nullopt;
 
-        if (it == lines_.cbegin())
+            return *std::prev(it);
+        }
+
+        while (first < last) {
+            auto const middle{first + (last - first) / 2};
+            if (compact_lines_[middle] <= offset)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        if (first == 0)
+            return std::nullopt;
+
+        return get_compact_line(first - 1);
+    }
+
+    std::size_t Source::line_count() const noexcept {
+        if (line_table_ == LineTable::Compact)
+            return compact_lines_.size();
+
+        return lines_.size();
+    }
+
+    std::size_t Source::get_line_start(std::size_t index) const noexcept {
+        if (line_table_ == LineTable::Compact)
+            return compact_lines_[index];
+
+        return lines_[index].byte_offset_;
+    }
+
+    Line Source::get_indexed_line(std::size_t index) const noexcept {
+        if (line_table_ == LineTable::Compact)
+            return get_compact_line(index);
+
+        return lines_[index];
+    }
+
+    void Source::index_lines(std::size_t count) const {
+        while (line_count() < count && scanned_ < buffer_.size()) {
+            index_through(open_line_start_);
+        }
+    }
+
+    std::optional<std::size_t> Source::find_offset(
+            LineColumn const &position, ColumnMode const &mode
+    ) const {
+        auto const &[line_nr, column]{position};
+        if (line_nr == 0 || column == 0 || line_nr > line_count())
+            return std::nullopt;
+
+        auto const line{get_indexed_line(line_nr - 1)};
+        auto const content{get_line(line)};
+
+        if (mode.unit_ == ColumnUnit::Byte) {
+            if (column - 1 > content.size())
+                return std::nullopt;
+
+            return line.byte_offset_ + column - 1;
+        }
+
+        auto const  tab_width{std::max(mode.tab_width_, std::size_t{1})};
+        std::size_t current{1};
+        std::size_t index{0};
+        while (index < content.size()) {
+            auto const width{
+                    mode.unit_ == ColumnUnit::Display && content[index] == '\t'
+                            ? tab_width - (current - 1) % tab_width
+                            : 1
+            };
+            if (column < current + width)
+                return line.byte_offset_ + index;
+
+            current += width;
+
+            // skip the continuation bytes of a multi-byte code point
+            ++index;
+            while (index < content.size() &&
+                   (static_cast<unsigned char>(content[index]) & 0xC0) == 0x80) {
+                ++index;
+            }
+        }
+
+        if (column != current)
             return std::nullopt;
 
-        --it;
+        return line.end();
+    }
+
+    std::optional<std::size_t> Source::offset_of(
+            std::size_t line, std::size_t column, ColumnMode const &mode
+    ) const {
+        std::unique_lock lock{index_mutex_, std::defer_lock};
+        if (indexing_ == Indexing::Lazy) {
+            lock.lock();
+            index_lines(line);
+        }
+
+        return find_offset(LineColumn{.line_ = line, .column_ = column}, mode);
+    }
+
+    std::vector<std::optional<std::size_t>> Source::offsets_of(
+            std::span<LineColumn const> positions, ColumnMode const &mode
+    ) const {
+        if (positions.empty())
+            return {};
+
+        std::unique_lock lock{index_mutex_, std::defer_lock};
+        if (indexing_ == Indexing::Lazy) {
+            lock.lock();
+            index_lines(
+                    std::ranges::max(positions, {}, &LineColumn::line_).line_
+            );
+        }
+
+        std::vector<std::optional<std::size_t>> offsets;
+        offsets.reserve(positions.size());
+        for (auto const &position : positions) {
+            offsets.emplace_back(find_offset(position, mode));
+        }
+
+        return offsets;
+    }
+
+    void Source::build_lookup_table() {
+        index_through(buffer_.size());
+
+        jump_table_ = {};
 
-        auto const last{lines_.back()};
-        if (it == lines_.cend() &&
-            offset <= last.byte_offset_ + last.byte_length_)
-            return last;
+        auto const count{line_count()};
+        if (count == 0)
+            return;
+
+        // Aim for a bucket spanning about lines_per_bucket lines on average.
+        auto const bucket_size{std::bit_floor(
+                (buffer_.size() / count + 1) *
+                internal::LineJumpTable::lines_per_bucket
+        )};
+        jump_table_.shift_ =
+                static_cast<std::size_t>(std::countr_zero(bucket_size));
+        jump_table_.first_lines_.resize(
+                (buffer_.size() >> jump_table_.shift_) + 1
+        );
+
+        std::size_t line{0};
+        for (std::size_t bucket{0}; bucket < jump_table_.first_lines_.size();
+             ++bucket) {
+            auto const bucket_start{bucket << jump_table_.shift_};
+            while (line + 1 < count &&
+                   get_line_start(line + 1) <= bucket_start) {
+                ++line;
+            }
 
-        return *it;
+            jump_table_.first_lines_[bucket] = line;
+        }
+    }
+
+    Line Source::get_compact_line(std::size_t index) const noexcept {
+        auto const start{compact_lines_[index]};
+        auto const end{[&]() -> std::size_t {
+            if (index + 1 < compact_lines_.size())
+                return compact_lines_[index + 1] - 1;
+
+            // the last line indexed so far is either the unterminated tail of
+            // the buffer or ends right before the line still being scanned
+            if (scanned_ == buffer_.size() && buffer_.back() != '\n')
+                return buffer_.size();
+
+            return open_line_start_ - 1;
+        }()};
+
+        return Line{
+                .byte_offset_ = start,
+                .byte_length_ = end - start,
+                .line_number_ = index + 1
+        };
     }
 
     std::size_t Source::size() const noexcept {
         return buffer_.size();
     }
+
+    void Source::apply_edit(Span const &replaced, std::string_view text) {
+        if (replaced.start() > replaced.end())
+            throw std::invalid_argument{"Edit cannot end before it starts"};
+
+        if (replaced.end() > buffer_.size())
+            throw std::out_of_range{"Edit is out of range of the source buffer"
+            };
+
+        auto const fully_indexed{scanned_ == buffer_.size()};
+
+        if (!edit_buffer_ || edit_buffer_.use_count() > 1) {
+            edit_buffer_ = std::make_shared<std::string>(buffer_);
+        }
+        // text may point into the old buffer, so that is released only after
+        // the replacement has been made
+        edit_buffer_->replace(replaced.start(), replaced.size(), text);
+        buffer_ = *edit_buffer_;
+        storage_.reset();
+        revision_ = next_revision();
+
+        if (line_table_ == LineTable::Compact)
+            apply_compact_edit(replaced.start());
+        else
+            apply_full_edit(replaced, text.size(), fully_indexed);
+
+        if (!jump_table_.first_lines_.empty())
+            build_lookup_table();
+    }
+
+    void Source::apply_full_edit(
+            Span const &replaced, std::size_t text_size, bool fully_indexed
+    ) {
+        // Lines whose '\n' comes before the edit are untouched, lines that
+        // start after it only move. Everything in between gets rescanned.
+        auto const keep{std::ranges::lower_bound(
+                lines_, replaced.start(), {},
+                [](Line const &line) { return line.end(); }
+        )};
+        auto const tail{std::ranges::upper_bound(
+                keep, lines_.end(), replaced.end(), {}, &Line::byte_offset_
+        )};
+        auto const rescan_from{
+                keep == lines_.begin() ? 0 : std::prev(keep)->end() + 1
+        };
+
+        if (!fully_indexed) {
+            // Whatever hasn't been indexed yet is picked up by the next
+            // lookup anyway, so drop everything from the edit onwards.
+            lines_.erase(keep, lines_.end());
+            scanned_         = rescan_from;
+            open_line_start_ = rescan_from;
+            return;
+        }
+
+        auto const delta{text_size - replaced.size()};// wraps if shrinking
+        auto const rescan_to{
+                tail == lines_.end() ? buffer_.size()
+                                     : tail->byte_offset_ + delta
+        };
+
+        std::vector<Line> rescanned;
+        auto const        open_line_start{internal::scan_lines(
+                buffer_, rescan_from, rescan_from, rescan_to, rescanned
+        )};
+        if (open_line_start < rescan_to) {
+            rescanned.emplace_back(
+                    Line{.byte_offset_ = open_line_start,
+                         .byte_length_ = rescan_to - open_line_start,
+                         .line_number_ = rescanned.size() + 1}
+            );
+        }
+
+        auto const first{
+                static_cast<std::size_t>(std::distance(lines_.begin(), keep))
+        };
+        auto const last{lines_.erase(keep, tail)};
+        for (auto it{last}; it != lines_.end(); ++it) it->byte_offset_ += delta;
+        lines_.insert(last, rescanned.cbegin(), rescanned.cend());
+
+        for (auto i{first}; i < lines_.size(); ++i) {
+            lines_[i].line_number_ = i + 1;
+        }
+
+        scanned_         = buffer_.size();
+        open_line_start_ = buffer_.size();
+    }
+
+    void Source::apply_compact_edit(std::size_t start) {
+        // Shifting every later line start would mean rewriting the deltas
+        // anyway, so the compact table is simply reindexed from the line the
+        // edit starts in.
+        auto const keep{
+                compact_lines_.empty()
+                        ? 0
+                        : compact_lines_.count_starting_at_or_before(start) - 1
+        };
+        auto const rescan_from{compact_lines_.empty() ? 0 : compact_lines_[keep]
+        };
+
+        compact_lines_.truncate(keep);
+        scanned_         = rescan_from;
+        open_line_start_ = rescan_from;
+
+        if (indexing_ == Indexing::Eager)
+            index_through(buffer_.size());
+    }
 }// namespace mjolnir
 
 std::size_t std::hash<mjolnir::Line>::operator()(mjolnir::Line const &line
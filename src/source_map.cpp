@@ -0,0 +1,89 @@
+#include <algorithm>             // for upper_bound
+#include <cstddef>               // for size_t
+#include <iterator>              // for distance
+#include <limits>                // for numeric_limits
+#include <mjolnir/source_map.hpp>// for SourceMap, SourceLocation
+#include <optional>              // for optional, nullopt
+#include <stdexcept>             // for invalid_argument, length_error
+#include <utility>               // for move
+
+#include "mjolnir/source.hpp"// for Source, Line
+#include "mjolnir/span.hpp"  // for Span
+
+namespace mjolnir {
+    std::optional<std::size_t> SourceMap::find_index(Offset offset
+    ) const noexcept {
+        auto const it{std::ranges::upper_bound(bases_, offset)};
+        if (it == bases_.cbegin())
+            return std::nullopt;
+
+        auto const index{
+                static_cast<std::size_t>(std::distance(bases_.cbegin(), it)) - 1
+        };
+        if (offset - bases_[index] > sources_[index].size())
+            return std::nullopt;
+
+        return index;
+    }
+
+    SourceMap::Offset SourceMap::add(Source source) {
+        auto const base{next_base_};
+        auto const room{std::numeric_limits<Offset>::max() - base};
+        if (source.size() >= room)
+            throw std::length_error{"SourceMap ran out of 32-bit offsets"};
+
+        next_base_ = base + static_cast<Offset>(source.size()) + 1;
+        bases_.emplace_back(base);
+        sources_.emplace_back(std::move(source));
+
+        return base;
+    }
+
+    std::size_t SourceMap::size() const noexcept {
+        return sources_.size();
+    }
+
+    Source const *SourceMap::get_source(Offset offset) const noexcept {
+        auto const index{find_index(offset)};
+        if (!index.has_value())
+            return nullptr;
+
+        return &sources_[index.value()];
+    }
+
+    std::optional<SourceLocation> SourceMap::resolve(Offset offset) const {
+        auto const index{find_index(offset)};
+        if (!index.has_value())
+            return std::nullopt;
+
+        auto const &source{sources_[index.value()]};
+        auto const  local{
+                static_cast<std::size_t>(offset - bases_[index.value()])
+        };
+        auto const line{source.get_line_info(local)};
+        if (!line.has_value())
+            return std::nullopt;
+
+        return SourceLocation{
+                .source_ = &source,
+                .offset_ = local,
+                .line_   = line.value(),
+                .column_ = line->get_column(local)
+        };
+    }
+
+    Span SourceMap::to_local(Offset start, Offset end) const {
+        auto const index{find_index(start)};
+        if (!index.has_value() || end < start ||
+            end - bases_[index.value()] > sources_[index.value()].size())
+            throw std::invalid_argument{
+                    "Span does not lie within a single source"
+            };
+
+        auto const base{bases_[index.value()]};
+        return Span{
+                static_cast<std::size_t>(start - base),
+                static_cast<std::size_t>(end - base)
+        };
+    }
+}// namespace mjolnir
@@ -1,6 +1,7 @@
 #include <algorithm>         // for max
 #include <cmath>             // for ceil
 #include <cstddef>           // for size_t
+#include <functional>        // for hash
 #include <mjolnir/source.hpp>// for Source, Line, Label, LabelDisplay
 #include <mjolnir/span.hpp>  // for Span, ColoredSpan
 #include <optional>          // for optional
@@ -97,14 +98,19 @@ namespace mjolnir {
         }
 
         bool ColoredSpan::is_highlight() const {
-            return label_ptr_ != nullptr &&
+            return label_ptr_ != nullptr && !multiline_ &&
                    label_ptr_->get_display().message_.has_value();
         }
-
-        bool ColoredSpan::is_single_line_highlightable(
-                Source const &source
-        ) const noexcept {
-            return label_ptr_ != nullptr && !span_.is_multiline(source);
-        }
     }// namespace internal
 }// namespace mjolnir
+
+std::size_t std::hash<mjolnir::Span>::operator()(mjolnir::Span const &span
+) const noexcept {
+    // Combined rather than xor-ed, which would have neighbouring spans such
+    // as [0, 2) and [2, 3) collide, std::hash<size_t> being the identity.
+    auto seed{std::hash<std::size_t>{}(span.start())};
+    seed ^= std::hash<std::size_t>{}(span.end()) + 0x9e3779b97f4a7c15 +
+            (seed << 6) + (seed >> 2);
+
+    return seed;
+}
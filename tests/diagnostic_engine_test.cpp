@@ -0,0 +1,239 @@
+#include <cstddef>    // for size_t
+#include <format>     // for format
+#include <stdexcept>  // for runtime_error
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <thread>     // for jthread
+#include <utility>    // for move, pair
+#include <vector>     // for vector
+
+#include "mjolnir/diagnostic_engine.hpp"// for DiagnosticEngine, EngineConfig
+#include "mjolnir/report.hpp"           // for Report, BasicReportKind
+#include "mjolnir/sink.hpp"             // for Sink, StringSink
+#include "mjolnir/source.hpp"           // for Source, Label
+#include "test.h"                       // for CHECK
+
+namespace {
+    using namespace mjolnir;
+
+    std::string const buffer{"let value = 42;\n"};
+    Source const      source{"test.c", buffer};
+
+    Report make_report(
+            BasicReportKind kind, std::string_view code = "E1",
+            std::size_t start = 4
+    ) {
+        Report report{kind, source, start};
+        report.with_code(code).with_label(Label{{start, start + 5}});
+        return report;
+    }
+
+    std::size_t count(std::string_view text, std::string_view needle) {
+        std::size_t found{0};
+        for (auto pos{text.find(needle)}; pos != std::string_view::npos;
+             pos = text.find(needle, pos + 1)) {
+            ++found;
+        }
+
+        return found;
+    }
+
+    // A warning is promoted before the policy is applied to it, so
+    // suppressing warnings doesn't swallow the errors they have become.
+    void promotes_before_suppressing() {
+        std::string out;
+        StringSink  sink{out};
+        {
+            DiagnosticEngine engine{
+                    sink,
+                    {.workers = 1,
+                     .policy  = {
+                              .warnings_as_errors = true,
+                              .suppressed_kinds   = {BasicReportKind::Warning}
+                     }}
+            };
+            CHECK(engine.would_emit(BasicReportKind::Warning));
+            CHECK(engine.submit(make_report(BasicReportKind::Warning)));
+            engine.flush();
+        }
+        CHECK(count(out, "Error") == 1);
+        CHECK(count(out, "Warning") == 0);
+
+        out.clear();
+        {
+            DiagnosticEngine engine{
+                    sink,
+                    {.workers = 1,
+                     .policy  = {
+                              .warnings_as_errors = true,
+                              .suppressed_kinds   = {BasicReportKind::Error}
+                     }}
+            };
+            CHECK(!engine.would_emit(BasicReportKind::Warning));
+            CHECK(!engine.submit(make_report(BasicReportKind::Warning)));
+            engine.flush();
+        }
+        CHECK(out.empty());
+    }
+
+    // Reports the queue drops give back what they took from the limits, so
+    // the limit is reached by reports that are actually written out.
+    void dropped_reports_keep_no_budget() {
+        constexpr std::size_t max_errors{5};
+
+        std::string out;
+        StringSink  sink{out};
+        std::size_t accepted{0};
+        {
+            DiagnosticEngine engine{
+                    sink,
+                    {.workers        = 1,
+                     .queue_capacity = 1,
+                     .backpressure   = Backpressure::CountAndDrop,
+                     .policy         = {.max_errors = max_errors}}
+            };
+            // until the queue is full, then only once a flush makes room
+            for (std::size_t i{0}; i < 1'000'000 && accepted < max_errors;
+                 ++i) {
+                if (engine.submit(make_report(BasicReportKind::Error)))
+                    ++accepted;
+                else
+                    engine.flush();
+            }
+            engine.flush();
+        }
+        CHECK(accepted == max_errors);
+        CHECK(count(out, "Error") == max_errors);
+    }
+
+    // Duplicates are dropped on submit, before they take from the limits,
+    // and stay dropped across flushes.
+    void deduplicates_on_submit() {
+        std::string out;
+        StringSink  sink{out};
+        {
+            DiagnosticEngine engine{
+                    sink,
+                    {.workers = 1,
+                     .policy  = {
+                              .max_errors      = 2,
+                              .deduplicate     = true,
+                              .note_duplicates = true
+                     }}
+            };
+            CHECK(engine.submit(make_report(BasicReportKind::Error)));
+            CHECK(!engine.submit(make_report(BasicReportKind::Error)));
+            CHECK(!engine.submit(make_report(BasicReportKind::Error)));
+            CHECK(engine.submit(make_report(BasicReportKind::Error, "E1", 0)));
+            engine.flush();
+
+            CHECK(!engine.submit(make_report(BasicReportKind::Error)));
+            engine.flush();
+        }
+        CHECK(count(out, "Error") == 2);
+        CHECK(count(out, "(2 more occurrences)") == 1);
+    }
+
+    // Reports are only duplicates if they really are the same, not merely
+    // because their hashes happen to match.
+    void keeps_reports_whose_hashes_collide() {
+        std::string out;
+        StringSink  sink{out};
+        {
+            DiagnosticEngine engine{
+                    sink, {.workers = 1, .policy = {.deduplicate = true}}
+            };
+            for (auto const [start, end] :
+                 {std::pair<std::size_t, std::size_t>{0, 2}, {2, 3}, {1, 4},
+                  {5, 6}}) {
+                Report report{BasicReportKind::Error, source, start};
+                report.with_code("E1").with_label(Label{{start, end}});
+                CHECK(engine.submit(std::move(report)));
+            }
+            engine.flush();
+        }
+        CHECK(count(out, "Error") == 4);
+    }
+
+    // Past queue_capacity, reports still wait for the flush rather than
+    // being written out in batches, so they all come out in one order.
+    void orders_everything_between_flushes() {
+        constexpr std::size_t producers{4};
+        constexpr std::size_t per_producer{8};
+
+        std::string lines;
+        for (std::size_t i{0}; i < producers * per_producer; ++i) {
+            lines += "let value = 42;\n";
+        }
+        Source const many{"test.c", lines};
+
+        std::string out;
+        StringSink  sink{out};
+        {
+            DiagnosticEngine engine{
+                    sink, {.workers = 2, .queue_capacity = 16}
+            };
+            {
+                std::vector<std::jthread> threads;
+                for (std::size_t t{0}; t < producers; ++t) {
+                    threads.emplace_back([&, t] {
+                        for (std::size_t i{per_producer}; i-- > 0;) {
+                            auto const start{(i * producers + t) * 16 + 4};
+                            Report report{BasicReportKind::Error, many, start};
+                            report.with_label(Label{{start, start + 5}});
+                            CHECK(engine.submit(std::move(report)));
+                        }
+                    });
+                }
+            }
+            engine.flush();
+        }
+
+        std::size_t last{0};
+        for (std::size_t line{1}; line <= producers * per_producer; ++line) {
+            auto const at{out.find(std::format("[test.c:{}:5]", line))};
+            CHECK(at != std::string::npos && at >= last);
+            last = at;
+        }
+    }
+
+    struct BrokenSink final : Sink {
+        void write(std::string_view) override {
+            throw std::runtime_error{"broken sink"};
+        }
+    };
+
+    // What the sink throws while the collector writes out a full batch on
+    // its own is rethrown by the next flush, rather than terminating.
+    void defers_sink_errors() {
+        BrokenSink sink;
+        bool       threw{false};
+        {
+            DiagnosticEngine engine{
+                    sink,
+                    {.workers            = 1,
+                     .queue_capacity     = 2,
+                     .write_full_batches = true}
+            };
+            for (std::size_t i{0}; i < 20; ++i) {
+                CHECK(engine.submit(make_report(BasicReportKind::Error)));
+            }
+
+            try {
+                engine.flush();
+            } catch (std::runtime_error const &) {
+                threw = true;
+            }
+        }
+        CHECK(threw);
+    }
+}// namespace
+
+int main() {
+    promotes_before_suppressing();
+    dropped_reports_keep_no_budget();
+    deduplicates_on_submit();
+    keeps_reports_whose_hashes_collide();
+    orders_everything_between_flushes();
+    defers_sink_errors();
+}
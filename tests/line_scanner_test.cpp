@@ -0,0 +1,133 @@
+#include <algorithm>  // for min
+#include <array>      // for array
+#include <cstddef>    // for size_t
+#include <random>     // for mt19937, uniform_int_distribution
+#include <string>     // for string
+#include <string_view>// for string_view
+#include <vector>     // for vector
+
+#include "line_scanner.h"    // for scan_lines, LineKernel, is_supported
+#include "mjolnir/source.hpp"// for Line
+#include "test.h"            // for CHECK
+
+namespace {
+    using namespace mjolnir;
+    using internal::LineKernel;
+
+    struct Scan final {
+        std::vector<Line> lines_;
+        std::size_t       open_line_;
+    };
+
+    // What every kernel has to agree with: one byte at a time, splitting on
+    // '\n' only, so a '\r' stays part of its line.
+    Scan scan_reference(std::string_view buffer) {
+        Scan        scan{.lines_ = {}, .open_line_ = 0};
+        std::size_t line_start{0};
+        for (std::size_t i{0}; i < buffer.size(); ++i) {
+            if (buffer[i] != '\n')
+                continue;
+
+            scan.lines_.push_back(Line{
+                    .byte_offset_ = line_start,
+                    .byte_length_ = i - line_start,
+                    .line_number_ = scan.lines_.size() + 1
+            });
+            line_start = i + 1;
+        }
+        scan.open_line_ = line_start;
+
+        return scan;
+    }
+
+    // Scanned in chunks `chunk` bytes long, as a lazily indexed source does.
+    Scan scan_with(
+            LineKernel kernel, std::string_view buffer, std::size_t chunk
+    ) {
+        Scan scan{.lines_ = {}, .open_line_ = 0};
+        for (std::size_t begin{0}; begin < buffer.size(); begin += chunk) {
+            auto const end{std::min(begin + chunk, buffer.size())};
+            scan.open_line_ = internal::scan_lines(
+                    kernel, buffer, scan.open_line_, begin, end, scan.lines_
+            );
+        }
+
+        return scan;
+    }
+
+    bool
+    same_lines(std::vector<Line> const &lhs, std::vector<Line> const &rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+
+        for (std::size_t i{0}; i < lhs.size(); ++i) {
+            if (lhs[i].byte_offset_ != rhs[i].byte_offset_ ||
+                lhs[i].byte_length_ != rhs[i].byte_length_ ||
+                lhs[i].line_number_ != rhs[i].line_number_)
+                return false;
+        }
+
+        return true;
+    }
+
+    constexpr std::array kernels{
+            LineKernel::Memchr, LineKernel::Sse2, LineKernel::Avx2
+    };
+
+    void check_kernels(std::string_view buffer) {
+        auto const expected{scan_reference(buffer)};
+
+        for (auto const kernel : kernels) {
+            if (!internal::is_supported(kernel))
+                continue;
+
+            for (std::size_t const chunk : {1, 7, 16, 31, 32, 33, 64, 4096}) {
+                auto const scan{scan_with(kernel, buffer, chunk)};
+                CHECK(same_lines(scan.lines_, expected.lines_));
+                CHECK(scan.open_line_ == expected.open_line_);
+            }
+        }
+    }
+
+    // Every length up to a few vectors, at every alignment a 32-byte load
+    // can have, so each kernel's tail loop and block loop both get to see
+    // every kind of byte.
+    void matches_reference_on_random_buffers() {
+        constexpr std::string_view alphabet{"ab\n\r"};
+
+        std::mt19937                               rng{42};
+        std::uniform_int_distribution<std::size_t> pick{
+                0, alphabet.size() - 1
+        };
+
+        std::string storage;
+        for (std::size_t size{0}; size <= 130; ++size) {
+            for (std::size_t alignment{0}; alignment < 32; ++alignment) {
+                storage.assign(alignment, 'x');
+                for (std::size_t i{0}; i < size; ++i) {
+                    storage.push_back(alphabet[pick(rng)]);
+                }
+
+                check_kernels(std::string_view{storage}.substr(alignment));
+            }
+        }
+    }
+
+    // A '\r' or "\r\n" right where one vector ends and the next begins.
+    void matches_reference_at_vector_boundaries() {
+        for (std::size_t const boundary : {15, 16, 31, 32, 63, 64}) {
+            for (std::string_view const ending : {"\r", "\n", "\r\n"}) {
+                for (std::size_t shift{0}; shift < 2; ++shift) {
+                    std::string buffer(96, 'a');
+                    buffer.replace(boundary - shift, ending.size(), ending);
+                    check_kernels(buffer);
+                }
+            }
+        }
+    }
+}// namespace
+
+int main() {
+    matches_reference_on_random_buffers();
+    matches_reference_at_vector_boundaries();
+}
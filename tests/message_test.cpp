@@ -0,0 +1,124 @@
+#include <array>          // for array
+#include <cstddef>        // for size_t, byte, max_align_t
+#include <format>         // for formatter
+#include <functional>     // for hash
+#include <memory_resource>// for monotonic_buffer_resource, null_memor...
+#include <optional>       // for optional
+#include <sstream>        // for ostringstream
+#include <string>         // for string
+#include <string_view>    // for string_view
+
+#include "mjolnir/message.hpp"      // for Message
+#include "mjolnir/report.hpp"       // for Report, ReportConfig
+#include "mjolnir/sink.hpp"         // for StringSink
+#include "mjolnir/snippet_cache.hpp"// for SnippetCache
+#include "mjolnir/source.hpp"       // for Source, Label
+#include "test.h"                   // for CHECK
+
+namespace {
+    // Counts how often it gets formatted.
+    struct Counted final {
+        std::size_t *formatted_;
+    };
+}// namespace
+
+template<>
+struct std::formatter<Counted> : std::formatter<std::string_view> {
+    auto format(Counted const &counted, std::format_context &context) const {
+        ++*counted.formatted_;
+        return std::formatter<std::string_view>::format("counted", context);
+    }
+};
+
+namespace {
+    using namespace mjolnir;
+
+    // However often a message or its copies are written, compared or
+    // hashed, its arguments are only formatted the first time.
+    void formats_once() {
+        std::size_t formatted{0};
+        Message const message{{}, "{} times", Counted{&formatted}};
+        CHECK(formatted == 0);
+
+        auto const  copy{message};
+        std::string out;
+        StringSink  sink{out};
+        message.write(sink);
+        copy.write(sink);
+        CHECK(out == "counted timescounted times");
+        CHECK(message == copy);
+        CHECK(std::hash<Message>{}(message) == std::hash<Message>{}(copy));
+        CHECK(copy.to_string() == "counted times");
+        CHECK(formatted == 1);
+    }
+
+    // Neither does keying a label's message for the snippet cache format
+    // it over again.
+    void keys_snippets_without_formatting() {
+        std::string const buffer{"let value = 42;\n"};
+        Source const      source{"test.c", buffer};
+        SnippetCache      cache{8};
+
+        std::size_t formatted{0};
+        Report      report{BasicReportKind::Error, source, 4};
+        report.with_label(Label{{4, 9}}.with_message(
+                                  "{} label", Counted{&formatted}
+                          ))
+                .with_config(ReportConfig{.snippet_cache = &cache});
+
+        std::ostringstream first;
+        report.print(first);
+        std::ostringstream second;
+        report.print(second);
+        CHECK(first.str() == second.str());
+        CHECK(formatted == 1);
+    }
+
+    // Copies out of an arena don't point back into it, so they outlive it.
+    // The arena is scribbled over to make sure nothing still reads it.
+    void copies_outlive_their_arena() {
+        std::string const buffer{"let value = 42;\n"};
+        Source const      source{"test.c", buffer};
+
+        alignas(std::max_align_t) std::array<std::byte, 16 * 1024> storage{};
+
+        std::optional<Message> message_copy;
+        std::optional<Report>  report_copy;
+        {
+            std::pmr::monotonic_buffer_resource arena{
+                    storage.data(), storage.size(),
+                    std::pmr::null_memory_resource()
+            };
+
+            Message const message{&arena, "{} + {}", 40, 2};
+            message_copy.emplace(message);
+
+            Report report{BasicReportKind::Error, source, 4, &arena};
+            report.with_message("{} errors", 1)
+                    .with_label(Label{{4, 9}, &arena}.with_message(
+                            "{} label", "formatted"
+                    ))
+                    .with_note("{} note", "formatted")
+                    .with_config(ReportConfig{
+                            .characters = characters::ascii,
+                            .color_mode = ColorMode::None
+                    });
+            report_copy.emplace(report);
+        }
+        storage.fill(std::byte{0xA5});
+
+        CHECK(message_copy->to_string() == "40 + 2");
+
+        std::ostringstream out;
+        report_copy->print(out);
+        CHECK(out.str().find("1 errors") != std::string::npos);
+        CHECK(out.str().find("formatted label") != std::string::npos);
+        CHECK(out.str().find("formatted note") != std::string::npos);
+    }
+}// namespace
+
+int main() {
+    formats_once();
+    keys_snippets_without_formatting();
+    copies_outlive_their_arena();
+}
@@ -0,0 +1,314 @@
+#include <array>          // for array
+#include <cstddef>        // for size_t, byte, max_align_t
+#include <cstdlib>        // for malloc, free
+#include <memory_resource>// for monotonic_buffer_resource, null_memor...
+#include <new>            // for bad_alloc
+#include <sstream>        // for ostringstream
+#include <string>         // for string
+#include <string_view>    // for string_view
+
+#include "mjolnir/color.hpp" // for ColorMode, colors
+#include "mjolnir/report.hpp"// for Report, ReportConfig, BasicReportKind
+#include "mjolnir/sink.hpp"  // for BufferSink
+#include "mjolnir/source.hpp"// for Source, Label
+#include "test.h"            // for CHECK
+
+namespace {
+    // How often anything was allocated on the global heap.
+    std::size_t global_allocations{0};
+}// namespace
+
+void *operator new(std::size_t size) {
+    ++global_allocations;
+    if (auto *const pointer{std::malloc(size > 0 ? size : 1)})
+        return pointer;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+    using namespace mjolnir;
+
+    std::string render(Report const &report) {
+        std::ostringstream out;
+        report.print(out);
+        return out.str();
+    }
+
+    Report make_report(Source const &source) {
+        Report report{BasicReportKind::Error, source, 4};
+        report.with_config(ReportConfig{
+                .characters = characters::ascii, .color_mode = ColorMode::None
+        });
+        return report;
+    }
+
+    // A label overlapping the one before it on a line is cut to start where
+    // that one ends, rather than having its gaps and connectors underflow.
+    void cuts_overlapping_labels() {
+        std::string const buffer{"let value = some_call(42);\n"};
+        Source const      source{"test.c", buffer};
+
+        auto report{make_report(source)};
+        report.with_label(Label{{4, 9}}.with_message("first"))
+                .with_label(Label{{6, 12}}.with_message("second"));
+
+        CHECK(render(report) == "Error\n"
+                                "   ,-[test.c:1:5]\n"
+                                "   |\n"
+                                " 1 | let value = some_call(42);\n"
+                                "   :     ^^|^^^|^\n"
+                                "   :       `------ first\n"
+                                "   :           |\n"
+                                "   :           `-- second\n"
+                                "   : \n"
+                                "---'\n");
+
+        // one the label before it covers entirely has nothing left to show
+        auto covered{make_report(source)};
+        covered.with_label(Label{{4, 12}}.with_message("outer"))
+                .with_label(Label{{5, 7}}.with_message("inner"));
+
+        auto const text{render(covered)};
+        CHECK(text.find("outer") != std::string::npos);
+        CHECK(text.find("inner") == std::string::npos);
+    }
+
+    // A span may end where the source does, one past its last line.
+    void labels_end_of_source() {
+        std::string const terminated{"let value = 42;\n"};
+        Source const      source{"test.c", terminated};
+
+        auto report{make_report(source)};
+        report.with_label(Label{{12, terminated.size()}}.with_message("here"));
+        CHECK(render(report) == "Error\n"
+                                "   ,-[test.c:1:5]\n"
+                                "   |\n"
+                                " 1 | let value = 42;\n"
+                                "   :             ^|^\n"
+                                "   :              `-- here\n"
+                                "   : \n"
+                                "---'\n");
+
+        std::string const unterminated{"let value"};
+        Source const      last_line{"test.c", unterminated};
+
+        auto last{make_report(last_line)};
+        last.with_label(Label{{4, unterminated.size()}}.with_message("here"));
+        CHECK(render(last) == "Error\n"
+                              "   ,-[test.c:1:5]\n"
+                              "   |\n"
+                              " 1 | let value\n"
+                              "   :     ^^|^^\n"
+                              "   :       `--- here\n"
+                              "   : \n"
+                              "---'\n");
+    }
+
+    // The reports of example/example1.cpp come out as they always have.
+    void renders_example() {
+        std::string const buffer{"int value = 4 << 1337.f;\n"
+                                 "\n"
+                                 "void main() {\n"
+                                 "    *ptr = 40.f + 2.f;\n"
+                                 "}\n"};
+        Source const      source{"test.c", buffer};
+
+        Report error{BasicReportKind::Error, source, 12};
+        error.with_message("Shift operation on non-integral type(s)")
+                .with_label(Label{{12, 13}}
+                                    .with_color(colors::light_green)
+                                    .with_message("This is of type int"))
+                .with_label(Label{{17, 23}}
+                                    .with_color(colors::light_magenta)
+                                    .with_message("This is of type float"))
+                .with_code("E03")
+                .with_help("Only integral types can be used as operands of a "
+                           "shift operation, consider casting the operands to "
+                           "an integral type.")
+                .with_note("This is a hard-coded diagnostic for demo purposes."
+                )
+                .with_config(ReportConfig{
+                        .characters = characters::ascii,
+                        .color_mode = ColorMode::None
+                });
+        CHECK(render(error) ==
+              "[E03] Error: Shift operation on non-integral type(s)\n"
+              "   ,-[test.c:1:13]\n"
+              "   |\n"
+              " 1 | int value = 4 << 1337.f;\n"
+              "   :             |    ^^|^^^\n"
+              "   :             `----------- This is of type int\n"
+              "   :                    |\n"
+              "   :                    `---- This is of type float\n"
+              "   : \n"
+              "   : Help: Only integral types can be used as operands of a "
+              "shift operation, consider casting the operands to an integral "
+              "type.\n"
+              "   : Note: This is a hard-coded diagnostic for demo purposes.\n"
+              "---'\n");
+
+        Report warning{BasicReportKind::Warning, source, 44};
+        warning.with_code("W16")
+                .with_message("Dereference on a null pointer")
+                .with_label(Label{{26, 39}})
+                .with_label(Label{{63, 64}})
+                .with_label(Label{{44, 48}}
+                                    .with_message("Dereference occurs here")
+                                    .with_color(colors::light_cyan))
+                .with_config(ReportConfig{
+                        .characters = characters::ascii,
+                        .color_mode = ColorMode::None
+                });
+        CHECK(render(warning) ==
+              "[W16] Warning: Dereference on a null pointer\n"
+              "   ,-[test.c:4:5]\n"
+              "   |\n"
+              " 3 | void main() {\n"
+              " 4 |     *ptr = 40.f + 2.f;\n"
+              "   :     ^|^^\n"
+              "   :      `--- Dereference occurs here\n"
+              "   : \n"
+              " 5 | }\n"
+              "---'\n");
+
+        std::string const other_buffer{"float *ptr = nullptr;"};
+        Source const      other_source{"incl.h", other_buffer};
+
+        Report continuation{
+                BasicReportKind::Continuation, other_source, 13
+        };
+        continuation
+                .with_label(Label{{13, 20}}
+                                    .with_message("Initialized as nullptr here")
+                                    .with_color(colors::light_cyan))
+                .with_config(ReportConfig{
+                        .characters = characters::ascii,
+                        .color_mode = ColorMode::None
+                });
+        CHECK(render(continuation) ==
+              "   ,-[incl.h:1:14]\n"
+              "   |\n"
+              " 1 | float *ptr = nullptr;\n"
+              "   :              ^^^|^^^\n"
+              "   :                 `---- Initialized as nullptr here\n"
+              "   : \n"
+              "---'\n");
+    }
+
+    // A label over many lines is drawn in a lane down the gutter, its
+    // interior left out past the first and last lines it covers, with
+    // context lines around it.
+    void elides_multiline_labels() {
+        std::string buffer;
+        for (std::size_t i{1}; i <= 12; ++i) {
+            buffer += "line " + std::to_string(i) + " of the function;\n";
+        }
+        Source const source{"test.c", buffer};
+
+        auto const start{buffer.find("line 3")};
+        auto const end{buffer.find("line 10") + 7};
+        Report     report{BasicReportKind::Error, source, start};
+        report.with_message("multi")
+                .with_label(
+                        Label{{start, end}}.with_message("spans many lines")
+                )
+                .with_config(ReportConfig{
+                        .characters    = characters::ascii,
+                        .color_mode    = ColorMode::None,
+                        .context_lines = 1
+                });
+
+        CHECK(render(report) == "Error: multi\n"
+                                "    ,-[test.c:3:1]\n"
+                                "    |\n"
+                                "  2 |     line 2 of the function;\n"
+                                "  3 | ,-> line 3 of the function;\n"
+                                "  4 | |   line 4 of the function;\n"
+                                "    : :   \n"
+                                "  9 | |   line 9 of the function;\n"
+                                " 10 | |-> line 10 of the function;\n"
+                                "    : `--- spans many lines\n"
+                                " 11 |     line 11 of the function;\n"
+                                "----'\n");
+    }
+
+    // A line wider than max_line_width shows only the columns around its
+    // labels, however far apart, with what is cut marked in between.
+    void windows_long_lines() {
+        std::string buffer{"let values = ["};
+        for (std::size_t i{0}; i < 60; ++i) {
+            buffer += std::to_string(i) + ", ";
+        }
+        buffer += "];\n";
+        Source const source{"wide.c", buffer};
+
+        auto const near{buffer.find("values")};
+        auto const far{buffer.find("57,")};
+        Report     report{BasicReportKind::Warning, source, near};
+        report.with_label(Label{{near, near + 6}}.with_message("declared here"))
+                .with_label(Label{{far, far + 2}}.with_message("far away"))
+                .with_config(ReportConfig{
+                        .characters     = characters::ascii,
+                        .color_mode     = ColorMode::None,
+                        .max_line_width = 40
+                });
+
+        CHECK(render(report) == "Warning\n"
+                                "   ,-[wide.c:1:5]\n"
+                                "   |\n"
+                                " 1 | ~values = [0~, 56, 57~\n"
+                                "   :  ^^|^^^            |^\n"
+                                "   :    `------------------ declared here\n"
+                                "   :                    |\n"
+                                "   :                    `-- far away\n"
+                                "   : \n"
+                                "---'\n");
+    }
+
+    // A report that allocates from an arena renders without going to the
+    // global heap, connectors and bars included.
+    void renders_within_its_arena() {
+        std::string const buffer{"let value = some_call(argument, other);\n"};
+        Source const      source{"test.c", buffer};
+        static_cast<void>(source.get_line_info(0));
+
+        alignas(std::max_align_t) std::array<std::byte, 16 * 1024> storage{};
+        std::pmr::monotonic_buffer_resource arena{
+                storage.data(), storage.size(), std::pmr::null_memory_resource()
+        };
+
+        Report report{BasicReportKind::Error, source, 4, &arena};
+        report.with_label(Label{{4, 9}, &arena}.with_message("first"))
+                .with_label(Label{{12, 21}, &arena}.with_message("second"))
+                .with_label(Label{{22, 30}, &arena}.with_message("third"))
+                .with_config(ReportConfig{
+                        .characters = characters::ascii,
+                        .color_mode = ColorMode::None
+                });
+
+        std::array<char, 1024> out{};
+        BufferSink             sink{out};
+        auto const             before{global_allocations};
+        report.render_to(sink);
+        CHECK(global_allocations == before);
+        CHECK(sink.view().find("third") != std::string_view::npos);
+    }
+}// namespace
+
+int main() {
+    cuts_overlapping_labels();
+    labels_end_of_source();
+    renders_example();
+    elides_multiline_labels();
+    windows_long_lines();
+    renders_within_its_arena();
+}
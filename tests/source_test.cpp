@@ -0,0 +1,312 @@
+#include <algorithm>   // for min
+#include <cstddef>     // for size_t
+#include <filesystem>  // for path, temp_directory_path, remove, exists
+#include <fstream>     // for ofstream
+#include <optional>    // for optional
+#include <random>      // for mt19937, uniform_int_distribution
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <system_error>// for system_error, errc
+#include <thread>      // for jthread
+#include <utility>     // for move
+
+#if __has_include(<sys/stat.h>)
+#define MJOLNIR_TEST_POSIX
+#include <sys/stat.h>// for mkfifo
+#endif
+
+#include "mjolnir/source.hpp"// for Source, Line, Indexing, LineTable
+#include "mjolnir/span.hpp"  // for Span
+#include "test.h"            // for CHECK
+
+namespace {
+    using namespace mjolnir;
+
+    // The line holding `offset`, found the slow way.
+    std::optional<Line> line_of(std::string_view buffer, std::size_t offset) {
+        if (offset >= buffer.size())
+            return std::nullopt;
+
+        std::size_t start{0};
+        std::size_t number{1};
+        for (std::size_t i{0}; i < offset; ++i) {
+            if (buffer[i] == '\n') {
+                start = i + 1;
+                ++number;
+            }
+        }
+
+        auto const newline{buffer.find('\n', offset)};
+        auto const end{newline == std::string_view::npos ? buffer.size()
+                                                         : newline};
+        return Line{
+                .byte_offset_ = start,
+                .byte_length_ = end - start,
+                .line_number_ = number
+        };
+    }
+
+    bool same_line(
+            std::optional<Line> const &lhs, std::optional<Line> const &rhs
+    ) {
+        if (!lhs.has_value() || !rhs.has_value())
+            return lhs.has_value() == rhs.has_value();
+
+        return lhs->byte_offset_ == rhs->byte_offset_ &&
+               lhs->byte_length_ == rhs->byte_length_ &&
+               lhs->line_number_ == rhs->line_number_;
+    }
+
+    // Looks up every offset, which takes in every bucket boundary, and one
+    // past the end, through a lookup table over every kind of line table.
+    void check_lookups(std::string_view buffer) {
+        for (auto const indexing : {Indexing::Eager, Indexing::Lazy}) {
+            for (auto const table : {LineTable::Full, LineTable::Compact}) {
+                Source source{"test.c", buffer, indexing, table};
+                source.build_lookup_table();
+
+                for (std::size_t offset{0}; offset <= buffer.size();
+                     ++offset) {
+                    CHECK(same_line(
+                            source.get_line_info(offset),
+                            line_of(buffer, offset)
+                    ));
+                }
+            }
+        }
+    }
+
+    void looks_up_edge_cases() {
+        check_lookups("");
+        check_lookups("\n");
+        check_lookups("single line");
+        check_lookups("single line\n");
+
+        // one line spanning many buckets between lines much shorter than one
+        std::string long_line;
+        for (std::size_t i{0}; i < 64; ++i) long_line += "a\n";
+        long_line += std::string(4096, 'x') + '\n';
+        for (std::size_t i{0}; i < 64; ++i) long_line += "b\n";
+        check_lookups(long_line);
+
+        // lines exactly as long as a power of two, so that line starts fall
+        // right on bucket boundaries
+        for (std::size_t const length : {1, 2, 4, 8, 16, 32, 64}) {
+            std::string aligned;
+            for (std::size_t i{0}; i < 100; ++i) {
+                aligned.append(length - 1, 'x');
+                aligned.push_back('\n');
+            }
+            check_lookups(aligned);
+        }
+    }
+
+    // How much of a source is indexed before it is edited.
+    enum class Indexed {
+        Not,
+        Partly,
+        Fully
+    };
+
+    // Random buffers and edits to them, the same for the same seed.
+    class RandomEdits final {
+        std::mt19937 random_;
+
+        std::size_t pick(std::size_t min, std::size_t max) {
+            std::uniform_int_distribution<std::size_t> distribution{min, max};
+            return distribution(random_);
+        }
+
+        // Random lines, some of them empty.
+        std::string text(std::size_t size) {
+            std::string text(size, 'x');
+            for (auto &c : text) {
+                if (pick(0, 7) == 0)
+                    c = '\n';
+            }
+            return text;
+        }
+
+    public:
+        explicit RandomEdits(unsigned seed)
+            : random_{seed} {
+        }
+
+        [[nodiscard]]
+        std::string buffer(std::size_t size) {
+            return text(size);
+        }
+
+        // Applies a random edit both to the source and to what it should
+        // hold afterwards: mostly replacements anywhere, then insertions at
+        // the end, deletions across a newline, and rarely deleting
+        // everything.
+        void apply(Source &source, std::string &expected) {
+            auto const  size{expected.size()};
+            auto        start{pick(0, size)};
+            auto        end{pick(start, std::min(start + 256, size))};
+            std::string inserted{};
+            if (auto const kind{pick(0, 15)}; kind < 10) {
+                inserted = text(pick(0, 64));
+            } else if (kind < 12) {
+                start    = size;
+                end      = start;
+                inserted = text(pick(0, 64));
+            } else if (kind < 15) {
+                if (auto const newline{expected.find('\n', start)};
+                    newline != std::string::npos) {
+                    start = newline - std::min(newline, pick(0, 8));
+                    end   = std::min(newline + pick(1, 8), size);
+                }
+            } else {
+                start = 0;
+                end   = size;
+            }
+
+            source.apply_edit(Span{start, end}, inserted);
+            expected.replace(start, end - start, inserted);
+        }
+    };
+
+    // Edits a source, indexed to the given extent beforehand, and looks up
+    // every offset of the result against a source built from scratch.
+    void check_edits(
+            RandomEdits &random, Indexing indexing, LineTable table,
+            Indexed indexed, bool lookup_table
+    ) {
+        for (std::size_t trial{0}; trial < 4; ++trial) {
+            // past the first lazily indexed chunk
+            auto   expected{random.buffer(96 * 1024)};
+            Source source{"test.c", expected, indexing, table};
+
+            if (indexed == Indexed::Partly)
+                static_cast<void>(source.get_line_info(0));
+            else if (indexed == Indexed::Fully)
+                static_cast<void>(source.get_line_info(expected.size()));
+
+            if (lookup_table)
+                source.build_lookup_table();
+
+            for (std::size_t edit{0}; edit <= trial * 4; ++edit) {
+                random.apply(source, expected);
+            }
+
+            Source const fresh{"test.c", expected};
+            CHECK(source.size() == expected.size());
+            for (std::size_t offset{0}; offset <= expected.size(); ++offset) {
+                CHECK(same_line(
+                        source.get_line_info(offset),
+                        fresh.get_line_info(offset)
+                ));
+            }
+        }
+    }
+
+    void applies_edits() {
+        RandomEdits random{42};
+
+        for (auto const indexing : {Indexing::Eager, Indexing::Lazy}) {
+            for (auto const table : {LineTable::Full, LineTable::Compact}) {
+                for (auto const indexed :
+                     {Indexed::Not, Indexed::Partly, Indexed::Fully}) {
+                    check_edits(random, indexing, table, indexed, false);
+                    check_edits(random, indexing, table, indexed, true);
+                }
+            }
+        }
+    }
+
+    // A lazy source can be copied while another thread indexes it; every
+    // copy picks up the index as it was, and goes on from there.
+    void copies_while_indexing() {
+        std::string buffer;
+        for (std::size_t i{0}; i < 64 * 1024; ++i) {
+            buffer += i % 7 == 0 ? "\n" : "line";
+        }
+        Source const source{"test.c", buffer, Indexing::Lazy};
+        Source const fresh{"test.c", buffer};
+
+        {
+            std::jthread const indexer{[&] {
+                for (std::size_t offset{0}; offset < buffer.size();
+                     offset += 4096) {
+                    static_cast<void>(source.get_line_info(offset));
+                }
+            }};
+
+            for (std::size_t i{0}; i < 64; ++i) {
+                auto       copy{source};
+                auto const offset{i * buffer.size() / 64};
+                CHECK(same_line(
+                        copy.get_line_info(offset), fresh.get_line_info(offset)
+                ));
+
+                Source moved{std::move(copy)};
+                CHECK(same_line(
+                        moved.get_line_info(buffer.size() - 1),
+                        fresh.get_line_info(buffer.size() - 1)
+                ));
+            }
+        }
+    }
+
+    std::filesystem::path temp_path(std::string_view name) {
+        return std::filesystem::temp_directory_path() /
+               ("mjolnir_source_test_" + std::string{name});
+    }
+
+    // Regular files are mapped, everything else is read; either way the
+    // source holds what the file did, or the error says why it can't.
+    void reads_files() {
+        std::string const contents{"first line\nsecond line\n"};
+
+        auto const regular{temp_path("regular")};
+        std::ofstream{regular, std::ios::binary} << contents;
+        auto const mapped{Source::from_file(regular)};
+        CHECK(mapped.get_line(0) == "first line");
+        CHECK(mapped.get_line(11) == "second line");
+        std::filesystem::remove(regular);
+
+        auto const empty{temp_path("empty")};
+        std::ofstream{empty, std::ios::binary};
+        CHECK(Source::from_file(empty).size() == 0);
+        std::filesystem::remove(empty);
+
+        // claims to be empty, but isn't
+        if (std::filesystem::path const status{"/proc/self/status"};
+            std::filesystem::exists(status))
+            CHECK(Source::from_file(status).size() > 0);
+
+#ifdef MJOLNIR_TEST_POSIX
+        auto const fifo{temp_path("fifo")};
+        std::filesystem::remove(fifo);
+        CHECK(::mkfifo(fifo.c_str(), 0600) == 0);
+        {
+            std::jthread const writer{[&] {
+                std::ofstream{fifo, std::ios::binary} << contents;
+            }};
+            auto const piped{Source::from_file(fifo)};
+            CHECK(piped.size() == contents.size());
+            CHECK(piped.get_line(11) == "second line");
+        }
+        std::filesystem::remove(fifo);
+
+        // opens fine, but can't be read, and says so
+        try {
+            static_cast<void>(
+                    Source::from_file(std::filesystem::temp_directory_path())
+            );
+            CHECK(false);
+        } catch (std::system_error const &error) {
+            CHECK(error.code() == std::errc::is_a_directory);
+        }
+#endif
+    }
+}// namespace
+
+int main() {
+    looks_up_edge_cases();
+    applies_edits();
+    copies_while_indexing();
+    reads_files();
+}
@@ -0,0 +1,19 @@
+#ifndef MJOLNIR_TEST_H
+#define MJOLNIR_TEST_H
+
+#include <cstdio> // for fprintf, stderr
+#include <cstdlib>// for exit, EXIT_FAILURE
+
+// Fails the test unless `condition` holds. Unlike assert, never compiled out.
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            std::fprintf(                                                      \
+                    stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,   \
+                    #condition                                                 \
+            );                                                                 \
+            std::exit(EXIT_FAILURE);                                           \
+        }                                                                      \
+    } while (false)
+
+#endif//MJOLNIR_TEST_H